@@ -1,14 +1,70 @@
 #pragma once
 
+#include <optional>
 #include <plan.h>
 
 using OutputAttrs = std::vector<std::tuple<size_t, DataType>>;
 
+// GatherOrder controls in which order build side values are gathered when
+// materializing the output of a join.
+enum class GatherOrder {
+    // Pick clustered gathers when the build side does not fit in cache.
+    Auto,
+    // Gather values in match order, one random access per value.
+    OrderPreserving,
+    // Cluster matches by build row id, gather sequentially and scatter back.
+    Clustered,
+};
+
+// Partitioning describes the output of a join run one partition at a time. The
+// rows of partition i all hash to i on the join key and follow those of
+// partition i - 1 in every column, on pages of their own.
+struct Partitioning {
+    // Output columns holding the join key.
+    std::vector<size_t>              key_columns;
+    std::vector<size_t>              partition_rows;
+    // Number of pages of every column in each partition.
+    std::vector<std::vector<size_t>> partition_pages;
+};
+
 // ColumnarExecutor implements the execution pipeline using a purely
 // columnar approach.
 struct ColumnarExecutor {
     ColumnarExecutor() = default;
 
+    // Order used to gather build side columns during materialization.
+    GatherOrder gather_order = GatherOrder::Auto;
+    // Memory the query may use. Joins whose hash table, matches and output would
+    // exceed it fall back to a grace hash join that partitions both inputs to
+    // disk.
+    size_t memory_budget = default_memory_budget();
+    // Bytes charged against the budget: the inputs of the plan, which the caller
+    // charges before executing it, and the intermediate results held by joins.
+    size_t memory_in_use = 0;
+    // Rows per batch pushed through a pipeline of joins. A join whose probe
+    // side is another join runs both as one pipeline and the output of the
+    // lower join is never materialized, 0 materializes the output of every join.
+    size_t batch_rows = 1024;
+    // Partitioning of the output of the last executed join, if it has one.
+    std::optional<Partitioning> output_partitioning;
+    // Key hashes of every output column of the last executed join, empty for
+    // columns without. Only joins run as a pipeline carry the hashes of their
+    // keys over to their output.
+    std::vector<std::vector<uint64_t>> output_hashes;
+    // Inputs of grace hash joins spilled along the partitions they already had.
+    size_t reused_partitionings = 0;
+    // Join inputs whose keys were not hashed again because the join producing
+    // them carried their hashes over.
+    size_t reused_key_hashes = 0;
+
+    // Returns half of the physical memory.
+    static size_t default_memory_budget();
+
+    // Charges the inputs of `plan`, which are held while it runs, to the memory
+    // in use. The tables cached by Table::from_csv are bounded by the cache
+    // capacity instead and are not charged.
+    void charge_inputs(const Plan& plan);
+
     // Execute the pipeline and return the result.
     ColumnarTable execute_impl(const Plan& plan, size_t node_idx);
 
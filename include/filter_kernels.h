@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "statement.h"
+
+// Instruction sets the comparison kernels are compiled for. The build uses
+// -march=native, but the kernels are selected at runtime so that a binary built
+// on one of the contest machines still runs on the others.
+enum class SimdLevel {
+    Scalar,
+    AVX2,
+    AVX512,
+};
+
+// Widest level supported by the running CPU, detected once.
+SimdLevel simd_level();
+
+inline const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::AVX512: return "AVX-512";
+    case SimdLevel::AVX2:   return "AVX2";
+    default:                return "scalar";
+    }
+}
+
+// The SIMD variants of the branch-free block kernels are the widest level and the one
+// below it, which can win when wide instructions lower the clock.
+inline SimdLevel simd_variant(size_t variant) {
+    return static_cast<SimdLevel>(static_cast<int>(simd_level()) - static_cast<int>(variant));
+}
+
+// Variants of the block kernels. Branch-free ones evaluate every row at the given SIMD
+// level and mask the result with the validity bitmap. Branching ones are scalar, they only
+// evaluate the valid rows and set the bits of those that match, which wins when most rows
+// are null or the outcome is predictable.
+struct BlockKernel {
+    SimdLevel level;
+    bool      branching;
+
+    BlockKernel(SimdLevel level, bool branching = false)
+    : level(level)
+    , branching(branching) {}
+};
+
+// Variants of the selection vector kernels. Branching ones only store the rows that pass,
+// which is cheapest while the outcome is predictable, that is when few or almost all rows
+// pass. Branch-free ones store every row and advance the output by the outcome.
+enum class SelectionKernel {
+    BranchFree,
+    Branching,
+};
+
+// Compares `size` values of `data` against `rhs` and writes one output bit per
+// row, already masked by the validity `bitmap`. `data` must start on a bitmap
+// byte boundary, output bytes are overwritten, not or'ed into.
+template <class T>
+void compare_kernel(Comparison::Op op,
+    BlockKernel                    kernel,
+    const T* __restrict__ data,
+    const uint8_t* __restrict__ bitmap,
+    uint8_t* __restrict__ output,
+    size_t size,
+    T      rhs);
+
+template <class T>
+void compare_kernel(Comparison::Op op,
+    const T* __restrict__ data,
+    const uint8_t* __restrict__ bitmap,
+    uint8_t* __restrict__ output,
+    size_t size,
+    T      rhs) {
+    compare_kernel(op, simd_level(), data, bitmap, output, size, rhs);
+}
+
+// Lists up to this size are matched with one vector compare per value, longer ones with
+// a binary search.
+constexpr size_t IN_LIST_SIMD_VALUES = 8;
+
+// Sets the bit of every row whose value is one of the `num_values` sorted, distinct
+// `values`, masked by the validity `bitmap` like compare_kernel.
+template <class T>
+void in_list_kernel(BlockKernel kernel,
+    const T* __restrict__ data,
+    const uint8_t* __restrict__ bitmap,
+    uint8_t* __restrict__ output,
+    size_t   size,
+    const T* values,
+    size_t   num_values);
+
+template <class T>
+void in_list_kernel(const T* __restrict__ data,
+    const uint8_t* __restrict__ bitmap,
+    uint8_t* __restrict__ output,
+    size_t   size,
+    const T* values,
+    size_t   num_values) {
+    in_list_kernel(simd_level(), data, bitmap, output, size, values, num_values);
+}
+
+// Bytes past the last dictionary code that a match table must be padded with.
+constexpr size_t CODE_LOOKUP_PADDING = 3;
+
+// Sets the bit of every row whose dictionary code has a non-zero entry in `matches`,
+// masked by the validity `bitmap`. Codes of null rows must still index the table.
+void code_lookup_kernel(BlockKernel kernel,
+    const uint16_t* __restrict__ codes,
+    const uint8_t* __restrict__ bitmap,
+    uint8_t* __restrict__ output,
+    size_t size,
+    const uint8_t* __restrict__ matches);
+
+inline void code_lookup_kernel(const uint16_t* __restrict__ codes,
+    const uint8_t* __restrict__ bitmap,
+    uint8_t* __restrict__ output,
+    size_t size,
+    const uint8_t* __restrict__ matches) {
+    code_lookup_kernel(simd_level(), codes, bitmap, output, size, matches);
+}
+
+// Writes the rows of the selection vector `rows` that are not null and compare true
+// against `rhs` to `output` and returns their number. `data` and `bitmap` are indexed by
+// row, `output` may be `rows` itself.
+template <class T>
+size_t select_kernel(Comparison::Op op,
+    SelectionKernel                 kernel,
+    const T* __restrict__ data,
+    const uint8_t* __restrict__ bitmap,
+    const uint32_t* rows,
+    size_t          num_rows,
+    uint32_t*       output,
+    T               rhs);
+
+// The selection vector counterpart of in_list_kernel.
+template <class T>
+size_t in_list_select_kernel(SelectionKernel kernel,
+    const T* __restrict__ data,
+    const uint8_t* __restrict__ bitmap,
+    const uint32_t* rows,
+    size_t          num_rows,
+    uint32_t*       output,
+    const T*        values,
+    size_t          num_values);
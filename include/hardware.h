@@ -4,9 +4,39 @@
 #pragma once
 
 #include <cassert>
-#include <cpuid.h>
+#include <chrono>
 #include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HARDWARE_X86 1
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+// Reads the time stamp counter, cheap enough to time a single filter block.
+// Other architectures read a steady clock in nanoseconds instead.
+inline auto read_tsc() noexcept -> uint64_t {
+#ifdef HARDWARE_X86
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+// Tells the CPU that the calling thread is spin waiting, other architectures
+// yield to the scheduler instead.
+inline void cpu_relax() noexcept {
+#ifdef HARDWARE_X86
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
 
+#ifdef HARDWARE_X86
 // Uses compiler exposed instrinsics should be available on Clang and GCC.
 //
 // Ref[1]: https://learn.microsoft.com/en-us/cpp/intrinsics/cpuid-cpuidex?view=msvc-170
@@ -43,3 +73,18 @@ inline auto has_rdtscp() noexcept -> bool {
 inline auto has_sse42() noexcept -> bool {
     return (CPUID(0x1).registers.ecx >> 20) & 1u;
 }
+
+// Returns true if CPU supports AVX2.
+//
+// Unlike SSE 4.2 the 256-bit registers also need OS support (XSAVE), which the
+// compiler builtin checks on top of CPUID Fn0000_0007_EBX[AVX2] = 1.
+inline auto has_avx2() noexcept -> bool {
+    return __builtin_cpu_supports("avx2");
+}
+
+// Returns true if CPU supports the AVX-512 foundation instructions, that is
+// CPUID Fn0000_0007_EBX[AVX512F] = 1 and the OS saves the opmask and zmm state.
+inline auto has_avx512() noexcept -> bool {
+    return __builtin_cpu_supports("avx512f");
+}
+#endif
@@ -1,62 +1,117 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
 #include <functional>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 
 #include <cstdint>
 
 #include "attribute.h"
+#include "common.h"
+#include "filter_kernels.h"
+#include "hardware.h"
 #include "statement.h"
 
+// Runs function(begin, end) over chunks of [0, num_tasks) that the workers and the
+// submitting thread claim from an atomic counter. Idle workers spin for a while before
+// they park, so that the many short runs of a query do not pay for a wake-up each. Tasks
+// may submit runs themselves: the submitter works on its own job until every chunk is
+// claimed, so a nested run completes even when all workers are busy.
 struct FilterThreadPool {
-    std::vector<std::thread>                              threads;
-    std::vector<std::unique_ptr<std::mutex>>              mtxes;
-    std::vector<std::unique_ptr<std::condition_variable>> cvs;
-    std::vector<uint8_t>                                  has_function;
-    std::vector<uint8_t>                                  finished;
-    std::vector<uint8_t>                                  destructed;
-    std::function<void(size_t, size_t)>                   function;
-    size_t                                                num_tasks;
-
-    size_t begin_idx(size_t thread_id) {
-        size_t base = num_tasks / threads.size();
-        size_t rem  = num_tasks % threads.size();
-        return thread_id * base + std::min(thread_id, rem);
+    // Pause instructions an idle worker spins for before it parks.
+    static constexpr size_t SPIN_ITERATIONS = 1 << 12;
+    // Chunks handed out per participating thread, to even out unequal tasks.
+    static constexpr size_t CHUNKS_PER_THREAD = 4;
+
+    struct Job {
+        std::function<void(size_t, size_t)> function;
+        size_t                              num_tasks;
+        size_t                              grain;
+        std::atomic<size_t>                 next{0};
+        std::atomic<size_t>                 done{0};
+
+        Job(std::function<void(size_t, size_t)> function, size_t num_tasks, size_t grain)
+        : function(std::move(function))
+        , num_tasks(num_tasks)
+        , grain(grain) {}
+
+        bool claimable() const { return next.load(std::memory_order_relaxed) < num_tasks; }
+
+        bool finished() const { return done.load(std::memory_order_acquire) == num_tasks; }
+
+        // Runs chunks until none is left to claim.
+        void work() {
+            for (;;) {
+                size_t begin = next.fetch_add(grain, std::memory_order_relaxed);
+                if (begin >= num_tasks) {
+                    return;
+                }
+                size_t end = std::min(begin + grain, num_tasks);
+                function(begin, end);
+                done.fetch_add(end - begin, std::memory_order_release);
+            }
+        }
+    };
+
+    using Handle = std::shared_ptr<Job>;
+
+    std::vector<std::thread> threads;
+    std::mutex               mtx;
+    std::condition_variable  cv;
+    // Jobs that may still have unclaimed chunks, the newest last. Guarded by mtx.
+    std::vector<Handle>      jobs;
+    size_t                   num_parked = 0;
+    bool                     destructed = false;
+    // Bumped under mtx for every submitted job, spinning workers poll it without.
+    std::atomic<uint64_t>    version{0};
+
+    // Picks the newest job with chunks left, preferring the innermost of nested runs.
+    Handle next_job(uint64_t& seen) {
+        std::lock_guard<std::mutex> lk(mtx);
+        seen = version.load(std::memory_order_relaxed);
+        for (auto itr = jobs.rbegin(); itr != jobs.rend(); ++itr) {
+            if ((*itr)->claimable()) {
+                return *itr;
+            }
+        }
+        return nullptr;
     }
 
-    void run_loop(size_t thread_id) {
-        auto& mtx = *mtxes[thread_id];
-        auto& cv  = *cvs[thread_id];
+    void run_loop() {
+        uint64_t seen = 0;
         for (;;) {
+            if (auto job = next_job(seen)) {
+                job->work();
+                continue;
+            }
+            bool submitted = false;
+            for (size_t i = 0; i < SPIN_ITERATIONS and not submitted; ++i) {
+                cpu_relax();
+                submitted = version.load(std::memory_order_relaxed) != seen;
+            }
+            if (submitted) {
+                continue;
+            }
             std::unique_lock<std::mutex> lk(mtx);
-            cv.wait(lk, [this, thread_id] {
-                return destructed[thread_id]
-                    or (has_function[thread_id] and not finished[thread_id]);
+            ++num_parked;
+            cv.wait(lk, [this, seen] {
+                return destructed or version.load(std::memory_order_relaxed) != seen;
             });
-            if (destructed[thread_id]) {
+            --num_parked;
+            if (destructed) {
                 break;
             }
-            size_t begin = begin_idx(thread_id);
-            size_t end   = begin_idx(thread_id + 1);
-            function(begin, end);
-            finished[thread_id] = true;
-            lk.unlock();
-            cv.notify_one();
         }
     }
 
     FilterThreadPool(unsigned num_threads) {
         for (unsigned i = 0; i < num_threads; ++i) {
-            mtxes.emplace_back(std::make_unique<std::mutex>());
-            cvs.emplace_back(std::make_unique<std::condition_variable>());
-        }
-        has_function.resize(num_threads);
-        finished.resize(num_threads);
-        destructed.resize(num_threads, 0);
-        for (unsigned i = 0; i < num_threads; ++i) {
-            threads.emplace_back([this, i] { run_loop(i); });
+            threads.emplace_back([this] { run_loop(); });
         }
     }
 
@@ -66,43 +121,62 @@ struct FilterThreadPool {
     FilterThreadPool& operator=(FilterThreadPool&&)      = delete;
 
     ~FilterThreadPool() {
-        for (size_t i = 0; i < threads.size(); ++i) {
-            auto&                       mtx = *mtxes[i];
+        {
             std::lock_guard<std::mutex> lk(mtx);
-            destructed[i] = true;
+            destructed = true;
+        }
+        cv.notify_all();
+        for (auto& thread: threads) {
+            thread.join();
         }
-        for (size_t i = 0; i < threads.size(); ++i) {
-            auto& cv = *cvs[i];
-            cv.notify_one();
+    }
+
+    // Starts a run without waiting for it, the caller must wait on the handle.
+    Handle submit(std::function<void(size_t, size_t)> function, size_t num_tasks) {
+        size_t grain = std::max<size_t>(1,
+            num_tasks / ((threads.size() + 1) * CHUNKS_PER_THREAD));
+        auto   job   = std::make_shared<Job>(std::move(function), num_tasks, grain);
+        bool   wake;
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            jobs.push_back(job);
+            version.fetch_add(1, std::memory_order_relaxed);
+            wake = num_parked > 0;
         }
-        for (size_t i = 0; i < threads.size(); ++i) {
-            threads[i].join();
+        if (wake) {
+            cv.notify_all();
         }
+        return job;
     }
 
-    void run(std::function<void(size_t, size_t)> function, size_t num_tasks) {
-        this->function  = std::move(function);
-        this->num_tasks = num_tasks;
-        for (size_t i = 0; i < threads.size(); ++i) {
-            auto&                       mtx = *mtxes[i];
+    // Works on the job until every chunk is claimed, then waits for the chunks other
+    // threads are still running.
+    void wait(const Handle& job) {
+        job->work();
+        {
             std::lock_guard<std::mutex> lk(mtx);
-            has_function[i] = true;
-            finished[i]     = false;
+            jobs.erase(std::find(jobs.begin(), jobs.end(), job));
         }
-        for (size_t i = 0; i < threads.size(); ++i) {
-            auto& cv = *cvs[i];
-            cv.notify_one();
+        for (size_t spins = 0; not job->finished(); ++spins) {
+            if (spins < SPIN_ITERATIONS) {
+                cpu_relax();
+            } else {
+                std::this_thread::yield();
+            }
         }
-        for (size_t i = 0; i < threads.size(); ++i) {
-            auto&                        mtx = *mtxes[i];
-            auto&                        cv  = *cvs[i];
-            std::unique_lock<std::mutex> lk(mtx);
-            cv.wait(lk, [this, i] { return finished[i]; });
+    }
+
+    void run(std::function<void(size_t, size_t)> function, size_t num_tasks) {
+        if (num_tasks == 0) {
+            return;
         }
+        wait(submit(std::move(function), num_tasks));
     }
 };
 
-inline FilterThreadPool filter_tp(12);
+// The submitting thread takes part in every run, so it needs one worker less than there
+// are hardware threads.
+inline FilterThreadPool filter_tp(std::max(1u, std::thread::hardware_concurrency()) - 1);
 
 struct InnerColumnBase {
     DataType type;
@@ -111,6 +185,10 @@ struct InnerColumnBase {
     : type(type) {}
 
     virtual ~InnerColumnBase() {}
+
+    virtual size_t size() const = 0;
+    // Bytes of memory held by the column.
+    virtual size_t bytes() const = 0;
 };
 
 template <class T>
@@ -167,160 +245,73 @@ struct InnerColumn: InnerColumnBase {
 
     T get(size_t idx) const { return data[idx]; }
 
-    std::vector<uint8_t> less(T rhs) const {
-        std::vector<uint8_t> ret(bitmap.size());
-        auto                 task = [this, rhs, &ret](size_t byte_begin, size_t byte_end) {
-            less(data.data() + byte_begin * 8,
-                bitmap.data() + byte_begin,
-                ret.data() + byte_begin,
-                std::min(byte_end * 8, data.size()) - byte_begin * 8,
-                rhs);
-        };
-        filter_tp.run(task, (data.size() + 7) / 8);
-        return ret;
-    }
-
-    std::vector<uint8_t> greater(T rhs) const {
-        std::vector<uint8_t> ret(bitmap.size());
-        auto                 task = [this, rhs, &ret](size_t byte_begin, size_t byte_end) {
-            greater(data.data() + byte_begin * 8,
-                bitmap.data() + byte_begin,
-                ret.data() + byte_begin,
-                std::min(byte_end * 8, data.size()) - byte_begin * 8,
-                rhs);
-        };
-        filter_tp.run(task, (data.size() + 7) / 8);
-        return ret;
-    }
-
-    std::vector<uint8_t> less_equal(T rhs) const {
-        std::vector<uint8_t> ret(bitmap.size());
-        auto                 task = [this, rhs, &ret](size_t byte_begin, size_t byte_end) {
-            less_equal(data.data() + byte_begin * 8,
-                bitmap.data() + byte_begin,
-                ret.data() + byte_begin,
-                std::min(byte_end * 8, data.size()) - byte_begin * 8,
-                rhs);
-        };
-        filter_tp.run(task, (data.size() + 7) / 8);
-        return ret;
-    }
-
-    std::vector<uint8_t> greater_equal(T rhs) const {
-        std::vector<uint8_t> ret(bitmap.size());
-        auto                 task = [this, rhs, &ret](size_t byte_begin, size_t byte_end) {
-            greater_equal(data.data() + byte_begin * 8,
-                bitmap.data() + byte_begin,
-                ret.data() + byte_begin,
-                std::min(byte_end * 8, data.size()) - byte_begin * 8,
-                rhs);
-        };
-        filter_tp.run(task, (data.size() + 7) / 8);
-        return ret;
-    }
-
-    std::vector<uint8_t> equal(T rhs) const {
-        std::vector<uint8_t> ret(bitmap.size());
-        auto                 task = [this, rhs, &ret](size_t byte_begin, size_t byte_end) {
-            equal(data.data() + byte_begin * 8,
-                bitmap.data() + byte_begin,
-                ret.data() + byte_begin,
-                std::min(byte_end * 8, data.size()) - byte_begin * 8,
-                rhs);
-        };
-        filter_tp.run(task, (data.size() + 7) / 8);
-        return ret;
-    }
-
-    std::vector<uint8_t> not_equal(T rhs) const {
-        std::vector<uint8_t> ret(bitmap.size());
-        auto                 task = [this, rhs, &ret](size_t byte_begin, size_t byte_end) {
-            not_equal(data.data() + byte_begin * 8,
-                bitmap.data() + byte_begin,
-                ret.data() + byte_begin,
-                std::min(byte_end * 8, data.size()) - byte_begin * 8,
-                rhs);
-        };
-        filter_tp.run(task, (data.size() + 7) / 8);
-        return ret;
-    }
-
-    static void less(const T* __restrict__ data,
-        const uint8_t* __restrict__ bitmap,
-        uint8_t* __restrict__ output,
-        size_t size,
-        T      rhs) {
-        for (size_t i = 0; i < size; ++i) {
-            size_t byte_idx   = i / 8;
-            size_t bit_idx    = i % 8;
-            output[byte_idx] |= (bitmap[byte_idx] & (0x1 << bit_idx)
-                                 & (static_cast<uint8_t>(data[i] < rhs) << bit_idx));
-        }
-    }
-
-    static void greater(const T* __restrict__ data,
-        const uint8_t* __restrict__ bitmap,
-        uint8_t* __restrict__ output,
-        size_t size,
-        T      rhs) {
-        for (size_t i = 0; i < size; ++i) {
-            size_t byte_idx   = i / 8;
-            size_t bit_idx    = i % 8;
-            output[byte_idx] |= (bitmap[byte_idx] & (0x1 << bit_idx)
-                                 & (static_cast<uint8_t>(data[i] > rhs) << bit_idx));
-        }
-    }
-
-    static void less_equal(const T* __restrict__ data,
-        const uint8_t* __restrict__ bitmap,
-        uint8_t* __restrict__ output,
-        size_t size,
-        T      rhs) {
-        for (size_t i = 0; i < size; ++i) {
-            size_t byte_idx   = i / 8;
-            size_t bit_idx    = i % 8;
-            output[byte_idx] |= (bitmap[byte_idx] & (0x1 << bit_idx)
-                                 & (static_cast<uint8_t>(data[i] <= rhs) << bit_idx));
-        }
-    }
-
-    static void greater_equal(const T* __restrict__ data,
-        const uint8_t* __restrict__ bitmap,
-        uint8_t* __restrict__ output,
-        size_t size,
-        T      rhs) {
-        for (size_t i = 0; i < size; ++i) {
-            size_t byte_idx   = i / 8;
-            size_t bit_idx    = i % 8;
-            output[byte_idx] |= (bitmap[byte_idx] & (0x1 << bit_idx)
-                                 & (static_cast<uint8_t>(data[i] >= rhs) << bit_idx));
-        }
-    }
-
-    static void equal(const T* __restrict__ data,
-        const uint8_t* __restrict__ bitmap,
-        uint8_t* __restrict__ output,
-        size_t size,
-        T      rhs) {
-        for (size_t i = 0; i < size; ++i) {
-            size_t byte_idx   = i / 8;
-            size_t bit_idx    = i % 8;
-            output[byte_idx] |= (bitmap[byte_idx] & (0x1 << bit_idx)
-                                 & (static_cast<uint8_t>(data[i] == rhs) << bit_idx));
-        }
-    }
-
-    static void not_equal(const T* __restrict__ data,
-        const uint8_t* __restrict__ bitmap,
-        uint8_t* __restrict__ output,
-        size_t size,
-        T      rhs) {
-        for (size_t i = 0; i < size; ++i) {
-            size_t byte_idx   = i / 8;
-            size_t bit_idx    = i % 8;
-            output[byte_idx] |= (bitmap[byte_idx] & (0x1 << bit_idx)
-                                 & (static_cast<uint8_t>(data[i] != rhs) << bit_idx));
-        }
+    size_t size() const override { return data.size(); }
+
+    size_t bytes() const override {
+        return data.capacity() * sizeof(T) + bitmap.capacity();
+    }
+
+    // Writes the result for the rows of bitmap bytes [byte_begin, byte_end) to output.
+    void compare_block(Comparison::Op op,
+        T                             rhs,
+        size_t                        byte_begin,
+        size_t                        byte_end,
+        uint8_t*                      output,
+        BlockKernel                   kernel) const {
+        compare_kernel(op,
+            kernel,
+            data.data() + byte_begin * 8,
+            bitmap.data() + byte_begin,
+            output,
+            std::min(byte_end * 8, data.size()) - byte_begin * 8,
+            rhs);
+    }
+
+    void in_list_block(const std::vector<T>& values,
+        size_t                               byte_begin,
+        size_t                               byte_end,
+        uint8_t*                             output,
+        BlockKernel                          kernel) const {
+        in_list_kernel(kernel,
+            data.data() + byte_begin * 8,
+            bitmap.data() + byte_begin,
+            output,
+            std::min(byte_end * 8, data.size()) - byte_begin * 8,
+            values.data(),
+            values.size());
+    }
+
+    // Selection vector counterparts of the above, keep the matching rows of `rows` in
+    // `output`, which may alias `rows`, and return their number.
+    size_t compare_selection(Comparison::Op op,
+        T                                   rhs,
+        const uint32_t*                     rows,
+        size_t                              num_rows,
+        uint32_t*                           output,
+        SelectionKernel                     kernel) const {
+        return select_kernel(op,
+            kernel,
+            data.data(),
+            bitmap.data(),
+            rows,
+            num_rows,
+            output,
+            rhs);
+    }
+
+    size_t in_list_selection(const std::vector<T>& values,
+        const uint32_t*                            rows,
+        size_t                                     num_rows,
+        uint32_t*                                  output,
+        SelectionKernel                            kernel) const {
+        return in_list_select_kernel(kernel,
+            data.data(),
+            bitmap.data(),
+            rows,
+            num_rows,
+            output,
+            values.data(),
+            values.size());
     }
 };
 
@@ -336,6 +327,10 @@ struct InnerColumn<std::string>: InnerColumnBase {
     std::vector<uint8_t> bitmap;
     size_t               row = 0;
 
+    // Filled by encode() for low cardinality columns. Null rows have code 0.
+    std::vector<uint16_t>         codes;
+    std::vector<std::string_view> dictionary;
+
     void bitmap_push_back(bool not_null) {
         if (row / 8 + 1 > bitmap.size()) {
             if (not_null) {
@@ -383,182 +378,174 @@ struct InnerColumn<std::string>: InnerColumnBase {
         return std::string_view{data.data() + begin, end - begin};
     }
 
-    std::vector<uint8_t> less(std::string_view rhs) const {
-        std::vector<uint8_t> ret(bitmap.size());
-        auto                 task = [this, &ret, &rhs](size_t byte_begin, size_t byte_end) {
-            for (size_t byte_idx = byte_begin; byte_idx < byte_end; ++byte_idx) {
-                for (size_t bit_idx = 0; bit_idx < 8; ++bit_idx) {
-                    size_t i = byte_idx * 8 + bit_idx;
-                    if (i >= row) {
-                        break;
-                    }
-                    bool             non_null = bitmap[byte_idx] & (0x1 << bit_idx);
-                    size_t           begin = i == 0 ? (size_t)0 : offsets[i - 1];
-                    size_t           end = offsets[i];
-                    std::string_view value{data.data() + begin, end - begin};
-                    ret[byte_idx] |=
-                        (static_cast<uint8_t>(non_null and value < rhs) << bit_idx);
-                }
-            }
-        };
-        filter_tp.run(task, (row + 7) / 8);
-        return ret;
-    }
+    size_t size() const override { return row; }
 
-    std::vector<uint8_t> greater(std::string_view rhs) const {
-        std::vector<uint8_t> ret(bitmap.size());
-        auto                 task = [this, &ret, &rhs](size_t byte_begin, size_t byte_end) {
-            for (size_t byte_idx = byte_begin; byte_idx < byte_end; ++byte_idx) {
-                for (size_t bit_idx = 0; bit_idx < 8; ++bit_idx) {
-                    size_t i = byte_idx * 8 + bit_idx;
-                    if (i >= row) {
-                        break;
-                    }
-                    bool             non_null = bitmap[byte_idx] & (0x1 << bit_idx);
-                    size_t           begin = i == 0 ? (size_t)0 : offsets[i - 1];
-                    size_t           end = offsets[i];
-                    std::string_view value{data.data() + begin, end - begin};
-                    ret[byte_idx] |=
-                        (static_cast<uint8_t>(non_null and value > rhs) << bit_idx);
-                }
-            }
-        };
-        filter_tp.run(task, (row + 7) / 8);
-        return ret;
+    size_t bytes() const override {
+        return data.capacity() + offsets.capacity() * sizeof(size_t) + bitmap.capacity()
+             + codes.capacity() * sizeof(uint16_t)
+             + dictionary.capacity() * sizeof(std::string_view);
     }
 
-    std::vector<uint8_t> less_equal(std::string_view rhs) const {
-        std::vector<uint8_t> ret(bitmap.size());
-        auto                 task = [this, &ret, &rhs](size_t byte_begin, size_t byte_end) {
-            for (size_t byte_idx = byte_begin; byte_idx < byte_end; ++byte_idx) {
-                for (size_t bit_idx = 0; bit_idx < 8; ++bit_idx) {
-                    size_t i = byte_idx * 8 + bit_idx;
-                    if (i >= row) {
-                        break;
-                    }
-                    bool             non_null = bitmap[byte_idx] & (0x1 << bit_idx);
-                    size_t           begin = i == 0 ? (size_t)0 : offsets[i - 1];
-                    size_t           end = offsets[i];
-                    std::string_view value{data.data() + begin, end - begin};
-                    ret[byte_idx] |=
-                        (static_cast<uint8_t>(non_null and value <= rhs) << bit_idx);
-                }
-            }
-        };
-        filter_tp.run(task, (row + 7) / 8);
-        return ret;
-    }
+    bool encoded() const { return not dictionary.empty(); }
 
-    std::vector<uint8_t> greater_equal(std::string_view rhs) const {
-        std::vector<uint8_t> ret(bitmap.size());
-        auto                 task = [this, &ret, &rhs](size_t byte_begin, size_t byte_end) {
-            for (size_t byte_idx = byte_begin; byte_idx < byte_end; ++byte_idx) {
-                for (size_t bit_idx = 0; bit_idx < 8; ++bit_idx) {
-                    size_t i = byte_idx * 8 + bit_idx;
-                    if (i >= row) {
-                        break;
-                    }
-                    bool             non_null = bitmap[byte_idx] & (0x1 << bit_idx);
-                    size_t           begin = i == 0 ? (size_t)0 : offsets[i - 1];
-                    size_t           end = offsets[i];
-                    std::string_view value{data.data() + begin, end - begin};
-                    ret[byte_idx] |=
-                        (static_cast<uint8_t>(non_null and value >= rhs) << bit_idx);
+    // Dictionary encodes the column once it is fully loaded, unless it has more distinct
+    // values than fit in a code or than a quarter of its rows. The dictionary refers to
+    // data, which must not change afterwards.
+    void encode() {
+        phmap::flat_hash_map<std::string_view, uint16_t> lookup;
+        std::vector<std::string_view>                    values;
+        std::vector<uint16_t>                            row_codes(row);
+        size_t max_values = std::min(row / 4, size_t(std::numeric_limits<uint16_t>::max()) + 1);
+        for (size_t i = 0; i < row; ++i) {
+            if (not is_not_null(i)) {
+                continue;
+            }
+            auto value = get(i);
+            auto itr   = lookup.find(value);
+            if (itr == lookup.end()) {
+                if (values.size() == max_values) {
+                    return;
                 }
+                itr = lookup.emplace(value, static_cast<uint16_t>(values.size())).first;
+                values.push_back(value);
             }
-        };
-        filter_tp.run(task, (row + 7) / 8);
-        return ret;
-    }
-
-    std::vector<uint8_t> equal(std::string_view rhs) const {
-        std::vector<uint8_t> ret(bitmap.size());
-        auto                 task = [this, &ret, &rhs](size_t byte_begin, size_t byte_end) {
-            for (size_t byte_idx = byte_begin; byte_idx < byte_end; ++byte_idx) {
-                for (size_t bit_idx = 0; bit_idx < 8; ++bit_idx) {
-                    size_t i = byte_idx * 8 + bit_idx;
-                    if (i >= row) {
-                        break;
+            row_codes[i] = itr->second;
+        }
+        codes      = std::move(row_codes);
+        dictionary = std::move(values);
+    }
+
+    // Applies a predicate evaluated per dictionary entry, `matches` holds one 0 or 1 byte
+    // per code followed by CODE_LOOKUP_PADDING bytes.
+    void lookup_block(const std::vector<uint8_t>& matches,
+        size_t                                    byte_begin,
+        size_t                                    byte_end,
+        uint8_t*                                  output,
+        BlockKernel                               kernel) const {
+        code_lookup_kernel(kernel,
+            codes.data() + byte_begin * 8,
+            bitmap.data() + byte_begin,
+            output,
+            std::min(byte_end * 8, row) - byte_begin * 8,
+            matches.data());
+    }
+
+    // Only the branching kernel skips the predicate for null rows, the level is ignored.
+    template <class Predicate>
+    void filter_block(size_t byte_begin,
+        size_t               byte_end,
+        uint8_t*             output,
+        BlockKernel          kernel,
+        Predicate&&          predicate) const {
+        for (size_t byte_idx = byte_begin; byte_idx < byte_end; ++byte_idx) {
+            size_t  begin = byte_idx * 8;
+            size_t  end   = std::min(begin + 8, row);
+            uint8_t mask  = 0;
+            if (kernel.branching) {
+                uint32_t valid = bitmap[byte_idx] & ((1u << (end - begin)) - 1);
+                for (; valid != 0; valid &= valid - 1) {
+                    uint32_t bit_idx = __builtin_ctz(valid);
+                    if (predicate(get(begin + bit_idx))) {
+                        mask |= 1u << bit_idx;
                     }
-                    bool             non_null = bitmap[byte_idx] & (0x1 << bit_idx);
-                    size_t           begin = i == 0 ? (size_t)0 : offsets[i - 1];
-                    size_t           end = offsets[i];
-                    std::string_view value{data.data() + begin, end - begin};
-                    ret[byte_idx] |=
-                        (static_cast<uint8_t>(non_null and value == rhs) << bit_idx);
+                }
+            } else {
+                for (size_t i = begin; i < end; ++i) {
+                    mask |= static_cast<uint8_t>(predicate(get(i))) << (i % 8);
                 }
             }
-        };
-        filter_tp.run(task, (row + 7) / 8);
-        return ret;
+            output[byte_idx - byte_begin] = mask & bitmap[byte_idx];
+        }
     }
 
-    std::vector<uint8_t> not_equal(std::string_view rhs) const {
-        std::vector<uint8_t> ret(bitmap.size());
-        auto                 task = [this, &ret, &rhs](size_t byte_begin, size_t byte_end) {
-            for (size_t byte_idx = byte_begin; byte_idx < byte_end; ++byte_idx) {
-                for (size_t bit_idx = 0; bit_idx < 8; ++bit_idx) {
-                    size_t i = byte_idx * 8 + bit_idx;
-                    if (i >= row) {
-                        break;
-                    }
-                    bool             non_null = bitmap[byte_idx] & (0x1 << bit_idx);
-                    size_t           begin = i == 0 ? (size_t)0 : offsets[i - 1];
-                    size_t           end = offsets[i];
-                    std::string_view value{data.data() + begin, end - begin};
-                    ret[byte_idx] |=
-                        (static_cast<uint8_t>(non_null and value != rhs) << bit_idx);
+    size_t lookup_selection(const std::vector<uint8_t>& matches,
+        const uint32_t*                                 rows,
+        size_t                                          num_rows,
+        uint32_t*                                       output,
+        SelectionKernel                                 kernel) const {
+        size_t num_selected = 0;
+        if (kernel == SelectionKernel::Branching) {
+            for (size_t i = 0; i < num_rows; ++i) {
+                uint32_t row = rows[i];
+                if (is_not_null(row) and matches[codes[row]]) {
+                    output[num_selected++] = row;
                 }
             }
-        };
-        filter_tp.run(task, (row + 7) / 8);
-        return ret;
-    }
-
-    std::vector<uint8_t> like(const std::string& rhs) const {
-        std::vector<uint8_t> ret(bitmap.size());
-        auto                 task = [this, &ret, &rhs](size_t byte_begin, size_t byte_end) {
-            for (size_t byte_idx = byte_begin; byte_idx < byte_end; ++byte_idx) {
-                for (size_t bit_idx = 0; bit_idx < 8; ++bit_idx) {
-                    size_t i = byte_idx * 8 + bit_idx;
-                    if (i >= row) {
-                        break;
-                    }
-                    bool             non_null = bitmap[byte_idx] & (0x1 << bit_idx);
-                    size_t           begin = i == 0 ? (size_t)0 : offsets[i - 1];
-                    size_t           end = offsets[i];
-                    std::string_view value{data.data() + begin, end - begin};
-                    ret[byte_idx] |=
-                        (static_cast<uint8_t>(non_null and Comparison::like_match(value, rhs))
-                            << bit_idx);
+            return num_selected;
+        }
+        for (size_t i = 0; i < num_rows; ++i) {
+            uint32_t row          = rows[i];
+            output[num_selected]  = row;
+            num_selected         += is_not_null(row) & matches[codes[row]];
+        }
+        return num_selected;
+    }
+
+    template <class Predicate>
+    size_t filter_selection(const uint32_t* rows,
+        size_t                              num_rows,
+        uint32_t*                           output,
+        SelectionKernel                     kernel,
+        Predicate&&                         predicate) const {
+        size_t num_selected = 0;
+        if (kernel == SelectionKernel::Branching) {
+            for (size_t i = 0; i < num_rows; ++i) {
+                uint32_t row = rows[i];
+                if (is_not_null(row) and predicate(get(row))) {
+                    output[num_selected++] = row;
                 }
             }
+            return num_selected;
+        }
+        for (size_t i = 0; i < num_rows; ++i) {
+            uint32_t row          = rows[i];
+            output[num_selected]  = row;
+            num_selected         += is_not_null(row) & predicate(get(row));
+        }
+        return num_selected;
+    }
+
+    // Writes the result for the rows of bitmap bytes [byte_begin, byte_end) to output.
+    void compare_block(Comparison::Op op,
+        const std::string&            rhs,
+        size_t                        byte_begin,
+        size_t                        byte_end,
+        uint8_t*                      output,
+        BlockKernel                   kernel) const {
+        std::string_view value = rhs;
+        auto             block = [&](auto&& predicate) {
+            filter_block(byte_begin, byte_end, output, kernel, predicate);
         };
-        filter_tp.run(task, (row + 7) / 8);
-        return ret;
+        switch (op) {
+        case Comparison::EQ:  return block([value](std::string_view v) { return v == value; });
+        case Comparison::NEQ: return block([value](std::string_view v) { return v != value; });
+        case Comparison::LT:  return block([value](std::string_view v) { return v < value; });
+        case Comparison::GT:  return block([value](std::string_view v) { return v > value; });
+        case Comparison::LEQ: return block([value](std::string_view v) { return v <= value; });
+        case Comparison::GEQ: return block([value](std::string_view v) { return v >= value; });
+        default:              unreachable();
+        }
     }
 
-    std::vector<uint8_t> not_like(const std::string& rhs) const {
-        std::vector<uint8_t> ret(bitmap.size());
-        auto                 task = [this, &ret, &rhs](size_t byte_begin, size_t byte_end) {
-            for (size_t byte_idx = byte_begin; byte_idx < byte_end; ++byte_idx) {
-                for (size_t bit_idx = 0; bit_idx < 8; ++bit_idx) {
-                    size_t i = byte_idx * 8 + bit_idx;
-                    if (i >= row) {
-                        break;
-                    }
-                    bool             non_null = bitmap[byte_idx] & (0x1 << bit_idx);
-                    size_t           begin = i == 0 ? (size_t)0 : offsets[i - 1];
-                    size_t           end = offsets[i];
-                    std::string_view value{data.data() + begin, end - begin};
-                    ret[byte_idx] |= (static_cast<uint8_t>(
-                                          non_null and not Comparison::like_match(value, rhs))
-                                      << bit_idx);
-                }
-            }
+    size_t compare_selection(Comparison::Op op,
+        const std::string&                  rhs,
+        const uint32_t*                     rows,
+        size_t                              num_rows,
+        uint32_t*                           output,
+        SelectionKernel                     kernel) const {
+        std::string_view value = rhs;
+        auto             select = [&](auto&& predicate) {
+            return filter_selection(rows, num_rows, output, kernel, predicate);
         };
-        filter_tp.run(task, (row + 7) / 8);
-        return ret;
+        switch (op) {
+        case Comparison::EQ:  return select([value](std::string_view v) { return v == value; });
+        case Comparison::NEQ: return select([value](std::string_view v) { return v != value; });
+        case Comparison::LT:  return select([value](std::string_view v) { return v < value; });
+        case Comparison::GT:  return select([value](std::string_view v) { return v > value; });
+        case Comparison::LEQ: return select([value](std::string_view v) { return v <= value; });
+        case Comparison::GEQ: return select([value](std::string_view v) { return v >= value; });
+        default:              unreachable();
+        }
     }
 };
 
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+
+// Picks one of a few interchangeable kernel variants per block, multi-armed bandit style.
+// Every variant is tried WARMUP_CALLS times, then the one with the fewest cycles per row
+// is used, except for one call in EXPLORE_PERIOD that retries another one, so that the
+// choice follows the selectivity of the blocks. All filter threads share the counters.
+struct KernelBandit {
+    static constexpr size_t   MAX_VARIANTS   = 3;
+    static constexpr uint64_t WARMUP_CALLS   = 2;
+    static constexpr uint64_t EXPLORE_PERIOD = 32;
+
+    size_t                num_variants = 0;
+    const char*           names[MAX_VARIANTS]{};
+    std::atomic<uint64_t> calls{0};
+    // Cycles per row, averaged exponentially over the calls of each variant.
+    std::atomic<float>    cost[MAX_VARIANTS]{};
+    std::atomic<uint64_t> uses[MAX_VARIANTS]{};
+
+    void   reset(std::initializer_list<const char*> variant_names);
+    size_t choose();
+    void   record(size_t variant, uint64_t cycles, size_t num_rows);
+
+    // Uses and cost of each variant that ran, e.g. "branching x12 0.81 c/row".
+    std::string summary() const;
+};
@@ -19,7 +19,11 @@
 #pragma once
 
 #include <attribute.h>
+#include <cstring>
 #include <statement.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 // #include <table.h>
 
 // supported attribute data types
@@ -57,6 +61,30 @@ struct alignas(8) Page {
     std::byte data[PAGE_SIZE];
 };
 
+// Copies a whole page to `page` with non-temporal stores, which bypass the
+// caches. Callers issue a store fence before the page is read by another
+// thread, see `finish_streaming`.
+inline void stream_page(Page* page, const std::byte* src) {
+#if defined(__SSE2__)
+    if (reinterpret_cast<uintptr_t>(page->data) % sizeof(__m128i) == 0
+        && reinterpret_cast<uintptr_t>(src) % sizeof(__m128i) == 0) {
+        auto* dst = reinterpret_cast<__m128i*>(page->data);
+        auto* in  = reinterpret_cast<const __m128i*>(src);
+        for (size_t i = 0; i < PAGE_SIZE / sizeof(__m128i); ++i) {
+            _mm_stream_si128(dst + i, _mm_load_si128(in + i));
+        }
+        return;
+    }
+#endif
+    memcpy(page->data, src, PAGE_SIZE);
+}
+
+inline void finish_streaming() {
+#if defined(__SSE2__)
+    _mm_sfence();
+#endif
+}
+
 struct Column {
     DataType           type;
     std::vector<Page*> pages;
@@ -148,13 +176,18 @@ struct Plan {
     }
 };
 
+// If `streaming` is set, pages are filled in a staging page and written to the
+// column with non-temporal stores once complete. Large outputs are written
+// that way so they don't evict data that is still needed from the caches.
 template <class T>
 struct ColumnInserter {
-    Column&              column;
-    size_t               last_page_idx = 0;
-    uint16_t             num_rows      = 0;
-    size_t               data_end      = data_begin();
-    std::vector<uint8_t> bitmap;
+    Column&               column;
+    size_t                last_page_idx = 0;
+    uint16_t              num_rows      = 0;
+    size_t                data_end      = data_begin();
+    std::vector<uint8_t>  bitmap;
+    bool                  streaming;
+    std::unique_ptr<Page> staging;
 
     constexpr static size_t data_begin() {
         if (sizeof(T) < 4) {
@@ -164,12 +197,19 @@ struct ColumnInserter {
         }
     }
 
-    ColumnInserter(Column& column)
-    : column(column) {
+    ColumnInserter(Column& column, bool streaming = false)
+    : column(column)
+    , streaming(streaming) {
         bitmap.resize(PAGE_SIZE);
+        if (streaming) {
+            staging = std::make_unique<Page>();
+        }
     }
 
     std::byte* get_page() {
+        if (streaming) {
+            return staging->data;
+        }
         if (last_page_idx == column.pages.size()) [[unlikely]] {
             column.new_page();
         }
@@ -184,6 +224,9 @@ struct ColumnInserter {
             static_cast<uint16_t>((data_end - data_begin()) / sizeof(T));
         size_t bitmap_size = (num_rows + 7) / 8;
         memcpy(page + PAGE_SIZE - bitmap_size, bitmap.data(), bitmap_size);
+        if (streaming) {
+            stream_page(column.new_page(), page);
+        }
         ++last_page_idx;
         num_rows = 0;
         data_end = data_begin();
@@ -224,28 +267,40 @@ struct ColumnInserter {
         if (num_rows != 0) {
             save_page();
         }
+        if (streaming) {
+            finish_streaming();
+        }
     }
 };
 
 template <>
 struct ColumnInserter<std::string> {
-    Column&              column;
-    size_t               last_page_idx = 0;
-    uint16_t             num_rows      = 0;
-    uint16_t             data_size     = 0;
-    size_t               offset_end    = 4;
-    std::vector<char>    data;
-    std::vector<uint8_t> bitmap;
+    Column&               column;
+    size_t                last_page_idx = 0;
+    uint16_t              num_rows      = 0;
+    uint16_t              data_size     = 0;
+    size_t                offset_end    = 4;
+    std::vector<char>     data;
+    std::vector<uint8_t>  bitmap;
+    bool                  streaming;
+    std::unique_ptr<Page> staging;
 
     constexpr static size_t offset_begin() { return 4; }
 
-    ColumnInserter(Column& column)
-    : column(column) {
+    ColumnInserter(Column& column, bool streaming = false)
+    : column(column)
+    , streaming(streaming) {
         data.resize(PAGE_SIZE);
         bitmap.resize(PAGE_SIZE);
+        if (streaming) {
+            staging = std::make_unique<Page>();
+        }
     }
 
     std::byte* get_page() {
+        if (streaming) {
+            return staging->data;
+        }
         if (last_page_idx == column.pages.size()) [[unlikely]] {
             column.new_page();
         }
@@ -267,6 +322,9 @@ struct ColumnInserter<std::string> {
             auto page_data_len = std::min(value.size() - offset, PAGE_SIZE - 4);
             *reinterpret_cast<uint16_t*>(page + 2) = page_data_len;
             memcpy(page + 4, value.data() + offset, page_data_len);
+            if (streaming) {
+                stream_page(column.new_page(), page);
+            }
             offset += page_data_len;
             ++last_page_idx;
         }
@@ -280,6 +338,9 @@ struct ColumnInserter<std::string> {
         size_t bitmap_size = (num_rows + 7) / 8;
         memcpy(page + offset_end, data.data(), data_size);
         memcpy(page + PAGE_SIZE - bitmap_size, bitmap.data(), bitmap_size);
+        if (streaming) {
+            stream_page(column.new_page(), page);
+        }
         ++last_page_idx;
         num_rows   = 0;
         data_size  = 0;
@@ -331,6 +392,9 @@ struct ColumnInserter<std::string> {
         if (num_rows != 0) {
             save_page();
         }
+        if (streaming) {
+            finish_streaming();
+        }
     }
 };
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <cstring>
 #include <memory>
 #include <optional>
 #include <string>
@@ -8,7 +10,11 @@
 #include <vector>
 
 #include <fmt/core.h>
+#include <parallel_hashmap/phmap.h>
 #include <re2/re2.h>
+#include <re2/set.h>
+
+#include "kernel_bandit.h"
 
 using Data    = std::variant<int32_t, int64_t, double, std::string, std::monostate>;
 using Literal = std::variant<int64_t, double, std::string, std::monostate>;
@@ -38,16 +44,95 @@ struct fmt::formatter<Data> {
 struct Attribute;
 struct Statement;
 struct Comparison;
+struct InList;
+struct LikeAny;
 struct LogicalOperation;
 struct InnerColumnBase;
 
+// Tables are filtered in blocks of this many bitmap bytes (8192 rows), small enough
+// for the intermediate results of a whole predicate tree to stay in L1.
+constexpr size_t FILTER_BLOCK_BYTES = 1024;
+
+// Conjunctions switch from bitmaps to selection vectors once fewer than one in this many
+// rows of a block are still selected.
+constexpr size_t SELECTION_VECTOR_DENSITY = 8;
+
 // AST Node
 struct Statement {
-    virtual ~Statement()                                                     = default;
-    virtual std::string          pretty_print(int indent = 0) const          = 0;
-    virtual bool                 eval(const std::vector<Data>& record) const = 0;
-    virtual std::vector<uint8_t> eval(
-        const std::vector<const InnerColumnBase*>& table) const = 0;
+    virtual ~Statement()                                            = default;
+    virtual std::string pretty_print(int indent = 0) const          = 0;
+    virtual bool        eval(const std::vector<Data>& record) const = 0;
+
+    // Evaluates the tree over the table in a single pass, one block at a time.
+    std::vector<uint8_t> eval(const std::vector<const InnerColumnBase*>& table) const;
+
+    // Sets up the state that all blocks of the table share, before any is evaluated.
+    virtual void prepare(const std::vector<const InnerColumnBase*>& table) const {}
+
+    // Writes the result bitmap of bytes [byte_begin, byte_end) to output. The range spans
+    // at most FILTER_BLOCK_BYTES bytes.
+    virtual void eval_block(const std::vector<const InnerColumnBase*>& table,
+        size_t                                                         byte_begin,
+        size_t                                                         byte_end,
+        uint8_t*                                                       output) const = 0;
+
+    // Writes the rows of the ascending selection vector `rows` that satisfy the predicate
+    // to `output`, which may alias `rows`, and returns their number.
+    virtual size_t eval_selection(const std::vector<const InnerColumnBase*>& table,
+        const uint32_t*                                                      rows,
+        size_t                                                               num_rows,
+        uint32_t*                                                            output) const = 0;
+
+    // Rough cycles per row of eval_block, used to order the terms of a conjunction or
+    // disjunction before they were measured. Called after prepare.
+    virtual double estimated_cost(const std::vector<const InnerColumnBase*>& table) const = 0;
+
+    // The kernel variants each node picked during the last eval, formatted like
+    // pretty_print.
+    virtual std::string kernel_report(int indent = 0) const = 0;
+};
+
+// A LIKE pattern split at its '%' wildcards, classified once when the predicate is built.
+// Only patterns containing '_' are left to RE2.
+struct LikePattern {
+    enum Kind {
+        EXACT,
+        PREFIX,
+        SUFFIX,
+        CONTAINS,
+        SEGMENTS,
+        REGEX
+    };
+
+    Kind                     kind = REGEX;
+    std::string              pattern;
+    std::string              prefix;
+    std::string              suffix;
+    std::vector<std::string> middle;
+
+    LikePattern() = default;
+    explicit LikePattern(std::string pattern);
+
+    // Offset of the first occurrence of needle in haystack, or npos.
+    static size_t search(std::string_view haystack, std::string_view needle) {
+        if (needle.size() > haystack.size()) {
+            return std::string_view::npos;
+        }
+        auto* found = memmem(haystack.data(), haystack.size(), needle.data(), needle.size());
+        return found ? static_cast<const char*>(found) - haystack.data()
+                     : std::string_view::npos;
+    }
+
+    static bool starts_with(std::string_view str, std::string_view part) {
+        return str.size() >= part.size() and memcmp(str.data(), part.data(), part.size()) == 0;
+    }
+
+    static bool ends_with(std::string_view str, std::string_view part) {
+        return str.size() >= part.size()
+           and memcmp(str.data() + str.size() - part.size(), part.data(), part.size()) == 0;
+    }
+
+    bool match(std::string_view str) const;
 };
 
 struct Comparison: Statement {
@@ -66,20 +151,48 @@ struct Comparison: Statement {
         IS_NOT_NULL
     };
 
-    Op      op;
-    Literal value;
+    Op          op;
+    Literal     value;
+    LikePattern like;
+
+    // Result per dictionary entry when the column is dictionary encoded, see prepare.
+    mutable const InnerColumnBase* encoded_column = nullptr;
+    mutable std::vector<uint8_t>   code_matches;
+
+    mutable KernelBandit block_kernels;
+    mutable KernelBandit selection_kernels;
 
     Comparison(size_t col, Op o, Literal val)
     : column(col)
     , op(o)
-    , value(std::move(val)) {}
+    , value(std::move(val)) {
+        auto* pattern = std::get_if<std::string>(&value);
+        if ((op == LIKE or op == NOT_LIKE) and pattern) {
+            like = LikePattern(*pattern);
+        }
+    }
 
     std::string pretty_print(int indent) const override {
         return fmt::format("{:{}}{} {} {}", "", indent, column, opToString(), valueToString());
     }
 
-    bool                 eval(const std::vector<Data>& record) const override;
-    std::vector<uint8_t> eval(const std::vector<const InnerColumnBase*>& table) const override;
+    using Statement::eval;
+
+    bool eval(const std::vector<Data>& record) const override;
+    void prepare(const std::vector<const InnerColumnBase*>& table) const override;
+    void eval_block(const std::vector<const InnerColumnBase*>& table,
+        size_t                                                 byte_begin,
+        size_t                                                 byte_end,
+        uint8_t*                                               output) const override;
+    size_t eval_selection(const std::vector<const InnerColumnBase*>& table,
+        const uint32_t*                                              rows,
+        size_t                                                       num_rows,
+        uint32_t*                                                    output) const override;
+    double estimated_cost(const std::vector<const InnerColumnBase*>& table) const override;
+    std::string kernel_report(int indent) const override;
+
+    // Evaluates a string comparison or LIKE on a single value.
+    bool match_string(std::string_view str) const;
 
     std::string opToString() const {
         switch (op) {
@@ -115,6 +228,26 @@ struct Comparison: Statement {
             value);
     }
 
+    static std::string like_to_regex(const std::string& pattern) {
+        std::string regex_str;
+        for (char c: pattern) {
+            if (c == '%') {
+                regex_str += ".*";
+            } else if (c == '_') {
+                regex_str += '.';
+            } else {
+                // escape sepcical characters
+                if (c == '\\' || c == '.' || c == '^' || c == '$' || c == '|' || c == '?'
+                    || c == '*' || c == '+' || c == '(' || c == ')' || c == '[' || c == ']'
+                    || c == '{' || c == '}') {
+                    regex_str += '\\';
+                }
+                regex_str += c;
+            }
+        }
+        return regex_str;
+    }
+
     static bool like_match(std::string_view str, const std::string& pattern) {
         // static cache and mutex
         thread_local auto regex_cache = std::unordered_map<std::string, std::unique_ptr<RE2>>{};
@@ -127,27 +260,9 @@ struct Comparison: Statement {
 
         // cache miss and compile
         if (!re) {
-            // conver to regex
-            std::string regex_str;
-            for (char c: pattern) {
-                if (c == '%') {
-                    regex_str += ".*";
-                } else if (c == '_') {
-                    regex_str += '.';
-                } else {
-                    // escape sepcical characters
-                    if (c == '\\' || c == '.' || c == '^' || c == '$' || c == '|' || c == '?'
-                        || c == '*' || c == '+' || c == '(' || c == ')' || c == '[' || c == ']'
-                        || c == '{' || c == '}') {
-                        regex_str += '\\';
-                    }
-                    regex_str += c;
-                }
-            }
-
             RE2::Options options;
 
-            auto new_re = std::make_unique<RE2>(regex_str, options);
+            auto new_re = std::make_unique<RE2>(like_to_regex(pattern), options);
             if (!new_re->ok()) {
                 return false; // invalid regex
             }
@@ -183,6 +298,133 @@ struct Comparison: Statement {
     }
 };
 
+inline bool LikePattern::match(std::string_view str) const {
+    switch (kind) {
+    case EXACT:    return str == prefix;
+    case PREFIX:   return starts_with(str, prefix);
+    case SUFFIX:   return ends_with(str, suffix);
+    case CONTAINS: return search(str, middle.front()) != std::string_view::npos;
+    case SEGMENTS: {
+        if (str.size() < prefix.size() + suffix.size() or not starts_with(str, prefix)
+            or not ends_with(str, suffix)) {
+            return false;
+        }
+        // The leftmost match of each segment leaves the most room for the next one.
+        str = str.substr(prefix.size(), str.size() - prefix.size() - suffix.size());
+        for (auto& segment: middle) {
+            size_t pos = search(str, segment);
+            if (pos == std::string_view::npos) {
+                return false;
+            }
+            str.remove_prefix(pos + segment.size());
+        }
+        return true;
+    }
+    case REGEX: return Comparison::like_match(str, pattern);
+    }
+    return false;
+}
+
+// `column IN (values...)`, matched in a single pass over the column rather than as a
+// chain of OR'ed equalities.
+struct InList: Statement {
+    size_t               column;
+    std::vector<Literal> values;
+
+    // Sorted, distinct lookup tables for each column type, built with the node.
+    std::vector<int32_t>                   int32_values;
+    std::vector<int64_t>                   int64_values;
+    std::vector<double>                    fp64_values;
+    std::vector<std::string>               string_values;
+    phmap::flat_hash_set<std::string_view> string_set;
+
+    mutable const InnerColumnBase* encoded_column = nullptr;
+    mutable std::vector<uint8_t>   code_matches;
+    mutable KernelBandit           block_kernels;
+    mutable KernelBandit           selection_kernels;
+
+    InList(size_t col, std::vector<Literal> vals);
+
+    InList(const InList&)            = delete;
+    InList& operator=(const InList&) = delete;
+
+    std::string pretty_print(int indent) const override;
+
+    using Statement::eval;
+
+    bool eval(const std::vector<Data>& record) const override;
+    void prepare(const std::vector<const InnerColumnBase*>& table) const override;
+    void eval_block(const std::vector<const InnerColumnBase*>& table,
+        size_t                                                 byte_begin,
+        size_t                                                 byte_end,
+        uint8_t*                                               output) const override;
+    size_t eval_selection(const std::vector<const InnerColumnBase*>& table,
+        const uint32_t*                                              rows,
+        size_t                                                       num_rows,
+        uint32_t*                                                    output) const override;
+    double estimated_cost(const std::vector<const InnerColumnBase*>& table) const override;
+    std::string kernel_report(int indent) const override;
+};
+
+// LIKE and NOT LIKE predicates on one column joined by OR, matched in a single pass over
+// the column. Patterns without '_' use their LikePattern kernels, the others are merged
+// into one RE2::Set.
+struct LikeAny: Statement {
+    size_t                                   column;
+    std::vector<std::unique_ptr<Comparison>> terms;
+
+    std::vector<const LikePattern*> patterns;
+    std::vector<const LikePattern*> negated_patterns;
+    std::unique_ptr<RE2::Set>       regex_set;
+
+    mutable const InnerColumnBase* encoded_column = nullptr;
+    mutable std::vector<uint8_t>   code_matches;
+    mutable KernelBandit           block_kernels;
+    mutable KernelBandit           selection_kernels;
+
+    explicit LikeAny(size_t col)
+    : column(col) {}
+
+    // Merges the two sides of an OR if both are LIKEs or LikeAny on the same column,
+    // otherwise returns nullptr and leaves them untouched.
+    static std::unique_ptr<Statement> merge(std::unique_ptr<Statement>& l,
+        std::unique_ptr<Statement>&                                      r);
+
+    // Rebuilds the matchers from the terms.
+    void compile();
+
+    bool match(std::string_view str) const {
+        for (auto* pattern: patterns) {
+            if (pattern->match(str)) {
+                return true;
+            }
+        }
+        for (auto* pattern: negated_patterns) {
+            if (not pattern->match(str)) {
+                return true;
+            }
+        }
+        return regex_set and regex_set->Match(str, nullptr);
+    }
+
+    std::string pretty_print(int indent) const override;
+
+    using Statement::eval;
+
+    bool eval(const std::vector<Data>& record) const override;
+    void prepare(const std::vector<const InnerColumnBase*>& table) const override;
+    void eval_block(const std::vector<const InnerColumnBase*>& table,
+        size_t                                                 byte_begin,
+        size_t                                                 byte_end,
+        uint8_t*                                               output) const override;
+    size_t eval_selection(const std::vector<const InnerColumnBase*>& table,
+        const uint32_t*                                              rows,
+        size_t                                                       num_rows,
+        uint32_t*                                                    output) const override;
+    double estimated_cost(const std::vector<const InnerColumnBase*>& table) const override;
+    std::string kernel_report(int indent) const override;
+};
+
 struct LogicalOperation: Statement {
     enum Type {
         AND,
@@ -193,21 +435,42 @@ struct LogicalOperation: Statement {
     Type                                    op_type;
     std::vector<std::unique_ptr<Statement>> children;
 
+    // Measured per child by every block, concurrently. Children are run in the order of
+    // cost per row over the fraction of rows they decide, so that cheap and selective
+    // terms go first, and the order is revised for each block as the counts grow.
+    struct ChildStats {
+        std::atomic<uint64_t> cycles{0};
+        std::atomic<uint64_t> rows_in{0};
+        std::atomic<uint64_t> rows_out{0};
+        double                estimated_cost = 0;
+    };
+
+    mutable std::vector<ChildStats> stats;
+
+    // Chooses how bitmaps are turned into selection vectors.
+    mutable KernelBandit selection_builders;
+
+    // Nested ANDs and ORs are flattened into one node, so that a conjunction can stop
+    // early across all of its terms.
     static std::unique_ptr<LogicalOperation> makeAnd(std::unique_ptr<Statement> l,
         std::unique_ptr<Statement>                                              r) {
         auto node     = std::make_unique<LogicalOperation>();
         node->op_type = AND;
-        node->children.push_back(std::move(l));
-        node->children.push_back(std::move(r));
+        node->add_child(std::move(l));
+        node->add_child(std::move(r));
         return node;
     }
 
-    static std::unique_ptr<LogicalOperation> makeOr(std::unique_ptr<Statement> l,
-        std::unique_ptr<Statement>                                             r) {
+    // LIKEs on the same column are merged into a LikeAny instead.
+    static std::unique_ptr<Statement> makeOr(std::unique_ptr<Statement> l,
+        std::unique_ptr<Statement>                                       r) {
         auto node     = std::make_unique<LogicalOperation>();
         node->op_type = OR;
-        node->children.push_back(std::move(l));
-        node->children.push_back(std::move(r));
+        node->add_child(std::move(l));
+        node->add_child(std::move(r));
+        if (node->children.size() == 1) {
+            return std::move(node->children.front());
+        }
         return node;
     }
 
@@ -240,6 +503,30 @@ struct LogicalOperation: Statement {
         return result;
     }
 
-    bool                 eval(const std::vector<Data>& record) const override;
-    std::vector<uint8_t> eval(const std::vector<const InnerColumnBase*>& table) const override;
+    // Appends a child, splicing in the children of a node of the same type.
+    void add_child(std::unique_ptr<Statement> child);
+
+    // Indices of the children, in the order they are evaluated for the next block.
+    std::vector<size_t> ranked_children() const;
+
+    void observe(size_t child_idx, uint64_t cycles, size_t rows_in, size_t rows_out) const {
+        stats[child_idx].cycles.fetch_add(cycles, std::memory_order_relaxed);
+        stats[child_idx].rows_in.fetch_add(rows_in, std::memory_order_relaxed);
+        stats[child_idx].rows_out.fetch_add(rows_out, std::memory_order_relaxed);
+    }
+
+    using Statement::eval;
+
+    bool eval(const std::vector<Data>& record) const override;
+    void prepare(const std::vector<const InnerColumnBase*>& table) const override;
+    void eval_block(const std::vector<const InnerColumnBase*>& table,
+        size_t                                                 byte_begin,
+        size_t                                                 byte_end,
+        uint8_t*                                               output) const override;
+    size_t eval_selection(const std::vector<const InnerColumnBase*>& table,
+        const uint32_t*                                              rows,
+        size_t                                                       num_rows,
+        uint32_t*                                                    output) const override;
+    double estimated_cost(const std::vector<const InnerColumnBase*>& table) const override;
+    std::string kernel_report(int indent) const override;
 };
@@ -16,10 +16,23 @@ public:
     : types_(types)
     , data_(data) {}
 
+    // Loads the rows of a csv file that pass `filter`. If `projection` is given
+    // only the listed columns are materialized, the other columns are empty.
     static ColumnarTable from_csv(const std::vector<Attribute>& attributes,
         const std::filesystem::path&                            path,
         Statement*                                              filter,
-        bool                                                    header = false);
+        const std::vector<size_t>*                              projection = nullptr,
+        bool                                                    header     = false);
+
+    // Bytes the tables and results cached by from_csv may hold together, the
+    // least recently used ones are evicted first.
+    static size_t cache_capacity;
+
+    // Returns a quarter of the physical memory.
+    static size_t default_cache_capacity();
+
+    // Returns the bytes held by the tables and results cached by from_csv.
+    static size_t cached_bytes();
 
     static Table from_columnar(const ColumnarTable& input);
 
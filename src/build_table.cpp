@@ -1,11 +1,13 @@
 #include <atomic>
 #include <charconv>
+#include <cstdlib>
 
 #include <common.h>
 #include <csv_parser.h>
 #include <inner_column.h>
 #include <plan.h>
 #include <table.h>
+#include <unistd.h>
 
 template <class Functor>
 class TableParser: public CSVParser {
@@ -88,8 +90,58 @@ TableParser(const std::vector<Attribute>& attributes,
 
 char buffer[1024 * 1024];
 
-std::unordered_map<std::filesystem::path, InnerTable>    table_cache;
-std::unordered_map<std::filesystem::path, ColumnarTable> result_cache;
+// CacheEntry is a table or a result cached by from_csv, with its size and the
+// time of its last use.
+template <class T>
+struct CacheEntry {
+    T        value;
+    size_t   bytes    = 0;
+    uint64_t last_use = 0;
+};
+
+std::unordered_map<std::filesystem::path, CacheEntry<InnerTable>>    table_cache;
+std::unordered_map<std::filesystem::path, CacheEntry<ColumnarTable>> result_cache;
+// Bytes held by the two caches above and the clock of their last uses.
+size_t   cache_bytes = 0;
+uint64_t cache_clock = 0;
+
+size_t Table::cache_capacity = Table::default_cache_capacity();
+
+size_t Table::default_cache_capacity() {
+    size_t physical = static_cast<size_t>(sysconf(_SC_PHYS_PAGES))
+                    * static_cast<size_t>(sysconf(_SC_PAGE_SIZE));
+    return physical / 4;
+}
+
+// Evicts the least recently used entries of both caches until `bytes` more fit
+// in the cache capacity. Returns false if they do not even fit in an empty cache,
+// the cache is then only trimmed to its capacity.
+bool make_cache_room(size_t bytes) {
+    bool   fits        = bytes <= Table::cache_capacity;
+    size_t room        = fits ? bytes : 0;
+    auto   by_last_use = [](const auto& a, const auto& b) {
+        return a.second.last_use < b.second.last_use;
+    };
+    while (cache_bytes + room > Table::cache_capacity) {
+        auto table_lru = std::min_element(table_cache.begin(), table_cache.end(), by_last_use);
+        auto result_lru =
+            std::min_element(result_cache.begin(), result_cache.end(), by_last_use);
+        if (result_lru == result_cache.end()
+            || (table_lru != table_cache.end()
+                && table_lru->second.last_use < result_lru->second.last_use)) {
+            cache_bytes -= table_lru->second.bytes;
+            table_cache.erase(table_lru);
+        } else {
+            cache_bytes -= result_lru->second.bytes;
+            result_cache.erase(result_lru);
+        }
+    }
+    return fits;
+}
+
+// Setting FILTER_KERNEL_REPORT prints the kernel variants picked for every
+// filter to stderr.
+const bool print_kernel_report = std::getenv("FILTER_KERNEL_REPORT") != nullptr;
 
 template <class T>
 size_t from_inner_to_column(const InnerColumnBase* inner,
@@ -132,22 +184,65 @@ ColumnarTable copy(const ColumnarTable& value) {
     return ret;
 }
 
+// Same as copy() but only copies the pages of the columns set in `materialized`.
+ColumnarTable copy(const ColumnarTable& value, const std::vector<bool>& materialized) {
+    ColumnarTable ret;
+    ret.num_rows = value.num_rows;
+    for (size_t column_idx = 0; column_idx < value.columns.size(); ++column_idx) {
+        auto& column = value.columns[column_idx];
+        ret.columns.emplace_back(column.type);
+        if (not materialized[column_idx]) {
+            continue;
+        }
+        auto& last_column = ret.columns.back();
+        for (auto* page: column.pages) {
+            auto* last_page = last_column.new_page();
+            memcpy(last_page->data, page->data, PAGE_SIZE);
+        }
+    }
+    return ret;
+}
+
+// Returns the number of rows set in the filter result bitmap.
+size_t count_selected(const std::vector<uint8_t>& results, size_t rows) {
+    size_t count = 0;
+    for (size_t byte_idx = 0; byte_idx < rows / 8; ++byte_idx) {
+        count += __builtin_popcount(results[byte_idx]);
+    }
+    if (rows % 8 != 0) {
+        count += __builtin_popcount(results[rows / 8] & ((1u << (rows % 8)) - 1));
+    }
+    return count;
+}
+
 ColumnarTable Table::from_csv(const std::vector<Attribute>& attributes,
     const std::filesystem::path&                            path,
     Statement*                                              filter,
+    const std::vector<size_t>*                              projection,
     bool                                                    header) {
     namespace views = ranges::views;
     InnerTableView                    table;
     std::vector<std::vector<Data>>    ground_truth;
     decltype(result_cache.find(path)) result_itr;
+    // Columns that are not read by the plan are never materialized.
+    std::vector<bool> materialized(attributes.size(), projection == nullptr);
+    if (projection) {
+        for (auto column_idx: *projection) {
+            materialized[column_idx] = true;
+        }
+    }
     if (not filter
         and (result_itr = result_cache.find(path), result_itr != result_cache.end())) {
         // fmt::println("    result cache hit");
-        return copy(result_itr->second);
+        result_itr->second.last_use = ++cache_clock;
+        return copy(result_itr->second.value, materialized);
     }
+    // Tables larger than the whole cache are only held by this call.
+    InnerTable uncached_table;
     if (auto itr = table_cache.find(path); itr != table_cache.end()) {
         // fmt::println("    cache hit");
-        table = itr->second;
+        itr->second.last_use = ++cache_clock;
+        table                = itr->second.value;
     } else {
         // fmt::println("    cache miss");
         InnerTable full_table;
@@ -241,13 +336,37 @@ ColumnarTable Table::from_csv(const std::vector<Attribute>& attributes,
         if (err != CSVParser::Ok) {
             throw std::runtime_error("CSV parse error");
         }
-        auto [iter, _] = table_cache.emplace(path, std::move(full_table));
-        table          = iter->second;
+        // Low cardinality string columns are filtered once per distinct value.
+        auto encode = [&full_table](size_t begin, size_t end) {
+            for (size_t column_idx = begin; column_idx < end; ++column_idx) {
+                auto* column = full_table.columns[column_idx].get();
+                if (column->type == DataType::VARCHAR) {
+                    reinterpret_cast<InnerColumn<std::string>*>(column)->encode();
+                }
+            }
+        };
+        filter_tp.run(encode, full_table.columns.size());
+        size_t bytes = 0;
+        for (const auto& column: full_table.columns) {
+            bytes += column->bytes();
+        }
+        if (make_cache_room(bytes)) {
+            auto [iter, _] = table_cache.emplace(path,
+                CacheEntry<InnerTable>{std::move(full_table), bytes, ++cache_clock});
+            cache_bytes += bytes;
+            table        = iter->second.value;
+        } else {
+            uncached_table = std::move(full_table);
+            table          = uncached_table;
+        }
     }
     ColumnarTable        ret;
     std::vector<uint8_t> results;
     if (filter) {
         results = filter->eval(table.columns);
+        if (print_kernel_report) {
+            fmt::println(stderr, "{}:\n{}", path.string(), filter->kernel_report());
+        }
     } else {
         results.resize((table.rows + 7) / 8, 0xff);
     }
@@ -255,54 +374,69 @@ ColumnarTable Table::from_csv(const std::vector<Attribute>& attributes,
     for (auto* column: table.columns) {
         ret.columns.emplace_back(column->type);
     }
-    std::atomic_size_t ret_rows;
-    auto               task = [&table, &ret, &results, &ret_rows](size_t begin, size_t end) {
+    // Unfiltered results are cached and therefore materialized completely.
+    bool cache_result = not filter;
+
+    auto task = [&](size_t begin, size_t end) {
         for (size_t column_idx = begin; column_idx < end; ++column_idx) {
+            if (not materialized[column_idx] and not cache_result) {
+                continue;
+            }
             auto* column = table.columns[column_idx];
             switch (column->type) {
             case DataType::INT32: {
-                auto filtered_rows = from_inner_to_column<int32_t>(column,
+                from_inner_to_column<int32_t>(column,
                     ret.columns[column_idx],
                     results,
                     table.rows);
-                ret_rows.store(filtered_rows, std::memory_order_relaxed);
                 break;
             }
             case DataType::INT64: {
-                auto filtered_rows = from_inner_to_column<int64_t>(column,
+                from_inner_to_column<int64_t>(column,
                     ret.columns[column_idx],
                     results,
                     table.rows);
-                ret_rows.store(filtered_rows, std::memory_order_relaxed);
                 break;
             }
             case DataType::FP64: {
-                auto filtered_rows = from_inner_to_column<double>(column,
+                from_inner_to_column<double>(column,
                     ret.columns[column_idx],
                     results,
                     table.rows);
-                ret_rows.store(filtered_rows, std::memory_order_relaxed);
                 break;
             }
             case DataType::VARCHAR: {
-                auto filtered_rows = from_inner_to_column<std::string>(column,
+                from_inner_to_column<std::string>(column,
                     ret.columns[column_idx],
                     results,
                     table.rows);
-                ret_rows.store(filtered_rows, std::memory_order_relaxed);
                 break;
             }
             }
         }
     };
     filter_tp.run(task, table.columns.size());
-    ret.num_rows = ret_rows.load(std::memory_order_relaxed);
-    if (not filter) {
-        result_cache.emplace(path, copy(ret));
+    ret.num_rows = count_selected(results, table.rows);
+    if (cache_result) {
+        size_t bytes = 0;
+        for (const auto& column: ret.columns) {
+            bytes += column.pages.size() * PAGE_SIZE;
+        }
+        // The table viewed by `table` may be evicted, it is no longer read.
+        if (make_cache_room(bytes)) {
+            auto [iter, _] = result_cache.emplace(path,
+                CacheEntry<ColumnarTable>{std::move(ret), bytes, ++cache_clock});
+            cache_bytes += bytes;
+            return copy(iter->second.value, materialized);
+        }
     }
     return ret;
 }
 
+size_t Table::cached_bytes() {
+    return cache_bytes;
+}
+
 bool get_bitmap(const uint8_t* bitmap, uint16_t idx) {
     auto byte_idx = idx / 8;
     auto bit      = idx % 8;
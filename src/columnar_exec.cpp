@@ -1,34 +1,316 @@
 #include "attribute.h"
 #include "fmt/base.h"
 #include "statement.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <columnar_exec.h>
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <german_table.h>
 #include <hardware__talos.h>
-#include <mutex>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <parallel_hashmap/phmap.h>
 #include <plan.h>
 #include <pthread.h>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <tuple>
+#include <type_traits>
+#include <unistd.h>
 #include <unordered_map>
+#include <utility>
+#include <variant>
 #include <vector>
 
 using phmap::flat_hash_map;
 using ExecuteResult = std::vector<std::vector<Data>>;
 using OutputAttrs   = std::vector<std::tuple<size_t, DataType>>;
 
-// PartionedHashTable is a vector of unordered maps, where each map represents a
-// a single partition that maps a single key to a vector of row indices.
+// Hashes a join key. Floating point keys are hashed by their bit pattern, -0.0
+// is folded into 0.0 since they compare equal.
 template <typename T>
-using PartitionedHashTable = std::vector<flat_hash_map<uint64_t, std::vector<size_t>>>;
+static inline uint64_t hash_join_key(const T& key) {
+    if constexpr (std::is_floating_point_v<T>) {
+        uint64_t bits = 0;
+        if (key != 0) {
+            std::memcpy(&bits, &key, sizeof(T));
+        }
+        return crc_hash64(bits);
+    } else {
+        return crc_hash64(key);
+    }
+}
+
+// ConcurrentHashTable is a chained hash table that all build threads insert
+// into at the same time without locks.
+//
+// The table is sized up front from the number of build rows: bucket heads hold
+// the first build row of their chain and every build row owns an entry with its
+// key and the next row of the chain. Inserting is a single CAS on the bucket
+// head, so there is no thread local table to merge, no mutex and no allocation
+// during the build.
+//
+// While inserting we also check whether the key is already in its chain so that
+// joins on a unique build side (e.g. title.id) can switch to a 1:1 table.
+template <typename T, typename RowId>
+struct ConcurrentHashTable {
+    static constexpr RowId EndOfChain = std::numeric_limits<RowId>::max();
+    static constexpr RowId NoMatch    = EndOfChain;
+    // Probes can pass the hash of their key if they already have it.
+    static constexpr bool HashesKeys = true;
+
+    struct Entry {
+        T     key;
+        RowId next;
+    };
+
+    size_t                                shift;
+    size_t                                num_buckets;
+    std::unique_ptr<std::atomic<RowId>[]> heads;
+    std::unique_ptr<Entry[]>              entries;
+    // Cleared as soon as two build rows share a key.
+    std::atomic<bool>                     unique_keys{true};
+
+    explicit ConcurrentHashTable(size_t num_rows) {
+        size_t bits = 1;
+        while ((size_t{1} << bits) < num_rows) {
+            ++bits;
+        }
+        num_buckets = size_t{1} << bits;
+        shift       = 64 - bits;
+        heads.reset(new std::atomic<RowId>[num_buckets]);
+        // All bits set is EndOfChain whatever the width of RowId.
+        static_assert(sizeof(std::atomic<RowId>) == sizeof(RowId));
+        std::memset(static_cast<void*>(heads.get()), 0xff, num_buckets * sizeof(RowId));
+        entries.reset(new Entry[num_rows]);
+    }
+
+    // Inserts `row` with `key` and its hash. Safe to call concurrently for
+    // distinct rows. Entries are published with release semantics so other
+    // inserters can walk the chain for duplicates.
+    void insert(const T& key, RowId row, uint64_t hash) {
+        auto& head    = heads[hash >> shift];
+        auto& entry   = entries[row];
+        entry.key     = key;
+        RowId first   = head.load(std::memory_order_acquire);
+        RowId checked = EndOfChain; // Start of the chain suffix already checked
+        do {
+            if (unique_keys.load(std::memory_order_relaxed)) {
+                for (RowId other = first; other != checked; other = entries[other].next) {
+                    if (entries[other].key == key) {
+                        unique_keys.store(false, std::memory_order_relaxed);
+                        break;
+                    }
+                }
+                checked = first;
+            }
+            entry.next = first;
+        } while (!head.compare_exchange_weak(first,
+            row,
+            std::memory_order_release,
+            std::memory_order_acquire));
+    }
+
+    // Returns the first build row whose key equals `key` or NoMatch, only
+    // meaningful on its own when the build keys are unique.
+    RowId find(const T& key) const { return find(key, hash_join_key(key)); }
+
+    RowId find(const T& key, uint64_t hash) const {
+        RowId row = heads[hash >> shift].load(std::memory_order_relaxed);
+        while (row != EndOfChain && entries[row].key != key) {
+            row = entries[row].next;
+        }
+        return row;
+    }
+
+    // Calls `on_match` with every build row whose key equals `key`.
+    template <typename F>
+    void probe(const T& key, F&& on_match) const {
+        probe(key, hash_join_key(key), std::forward<F>(on_match));
+    }
+
+    template <typename F>
+    void probe(const T& key, uint64_t hash, F&& on_match) const {
+        RowId row = heads[hash >> shift].load(std::memory_order_relaxed);
+        while (row != EndOfChain) {
+            const auto& entry = entries[row];
+            if (entry.key == key) {
+                on_match(row);
+            }
+            row = entry.next;
+        }
+    }
+};
+
+// KeyRange tracks the smallest and largest build key seen. Only integer keys
+// are tracked, the range of other types stays empty.
+template <typename T>
+struct KeyRange {
+    T      min   = std::numeric_limits<T>::max();
+    T      max   = std::numeric_limits<T>::lowest();
+    size_t count = 0;
+
+    void add(const T& key) {
+        min = std::min(min, key);
+        max = std::max(max, key);
+        ++count;
+    }
+
+    void merge(const KeyRange& other) {
+        min    = std::min(min, other.min);
+        max    = std::max(max, other.max);
+        count += other.count;
+    }
+};
+
+// Unique integer keys are stored in a DenseKeyTable when their range is at most
+// this many times the number of keys.
+constexpr size_t DenseKeyTableMaxSpread = 8;
+
+// DenseKeyTable maps every key of a unique build side to its build row through
+// a plain array indexed by `key - min_key`, so a probe is a single load with
+// neither a hash nor a chain to walk. This is the common case for primary keys
+// such as title.id, company_name.id or keyword.id.
+template <typename T, typename RowId>
+struct DenseKeyTable {
+    static constexpr RowId NoMatch    = std::numeric_limits<RowId>::max();
+    static constexpr bool  HashesKeys = false;
+
+    T                  min_key;
+    // One slot per key in the range plus a trailing NoMatch slot.
+    std::vector<RowId> rows;
+
+    explicit DenseKeyTable(const KeyRange<T>& range)
+    : min_key(range.min)
+    , rows(static_cast<uint64_t>(range.max) - static_cast<uint64_t>(range.min) + 2, NoMatch) {}
+
+    // Returns true if a unique build side with `range` should use a dense table.
+    static bool fits(const KeyRange<T>& range) {
+        if (range.count == 0) {
+            return false;
+        }
+        uint64_t span = static_cast<uint64_t>(range.max) - static_cast<uint64_t>(range.min);
+        return span < range.count * DenseKeyTableMaxSpread;
+    }
+
+    RowId find(const T& key) const {
+        // Out of range keys are clamped onto the trailing NoMatch slot which
+        // compiles to a conditional move instead of a branch.
+        uint64_t slot = static_cast<uint64_t>(key) - static_cast<uint64_t>(min_key);
+        uint64_t last = rows.size() - 1;
+        return rows[slot < last ? slot : last];
+    }
+};
+
+// Build sides with at most this many rows are built serially into a
+// SmallBuildTable whose keys and rows fit in L1.
+constexpr size_t SmallBuildMaxRows = SPC__LEVEL1_DCACHE_SIZE / (2 * sizeof(uint64_t));
+
+// SmallBuildTables with at most this many rows are probed by comparing the key
+// against all of them at once instead of a binary search.
+constexpr size_t SmallBuildBlockRows = 16;
+
+// SmallBuildTable holds tiny build sides such as filtered info_type, kind_type
+// or role_type as a sorted array. It is built by a single thread and shared by
+// all probe threads.
+template <typename T, typename RowId>
+struct SmallBuildTable {
+    static constexpr RowId NoMatch    = std::numeric_limits<RowId>::max();
+    static constexpr bool  HashesKeys = false;
+
+    // Keys sorted in ascending order and the build row of every key.
+    std::vector<T>     keys;
+    std::vector<RowId> rows;
+    bool               unique_keys = true;
+    // Copy of `keys` padded to a full block when there are few enough of them,
+    // the comparison loop then has a constant trip count and compiles to a few
+    // SIMD compares.
+    std::array<T, SmallBuildBlockRows> block{};
+
+    bool use_block() const { return keys.size() <= SmallBuildBlockRows; }
+
+    // Returns a bitmask of the positions in `block` whose key equals `key`.
+    uint32_t match_block(const T& key) const {
+        uint32_t mask = 0;
+        for (size_t i = 0; i < SmallBuildBlockRows; ++i) {
+            mask |= static_cast<uint32_t>(block[i] == key) << i;
+        }
+        return mask & ((uint32_t{1} << keys.size()) - 1);
+    }
+
+    // Calls `on_match` with every build row whose key equals `key`.
+    template <typename F>
+    void probe(const T& key, F&& on_match) const {
+        if (use_block()) {
+            for (uint32_t mask = match_block(key); mask != 0; mask &= mask - 1) {
+                on_match(rows[__builtin_ctz(mask)]);
+            }
+            return;
+        }
+        auto it = std::lower_bound(keys.begin(), keys.end(), key);
+        for (; it != keys.end() && *it == key; ++it) {
+            on_match(rows[it - keys.begin()]);
+        }
+    }
+
+    // Returns the first build row whose key equals `key` or NoMatch.
+    RowId find(const T& key) const {
+        if (use_block()) {
+            uint32_t mask = match_block(key);
+            return mask != 0 ? rows[__builtin_ctz(mask)] : NoMatch;
+        }
+        auto it = std::lower_bound(keys.begin(), keys.end(), key);
+        return it != keys.end() && *it == key ? rows[it - keys.begin()] : NoMatch;
+    }
+};
+
+// JoinMatches stores the matches produced by the probe phase as two parallel
+// row id arrays (structure of arrays) instead of a vector of pairs, so that
+// materialization streams over a single side at a time.
+//
+// RowId is uint32_t whenever both join inputs have less than 2^32 rows which
+// halves the memory and bandwidth of the match list, otherwise we fall back
+// to uint64_t.
+template <typename RowId>
+struct JoinMatches {
+    std::vector<RowId> probe_rows;
+    std::vector<RowId> build_rows;
+
+    size_t size() const { return probe_rows.size(); }
+
+    void reserve(size_t capacity) {
+        probe_rows.reserve(capacity);
+        build_rows.reserve(capacity);
+    }
+
+    void resize(size_t size) {
+        probe_rows.resize(size);
+        build_rows.resize(size);
+    }
 
+    void emplace_back(size_t probe_row, size_t build_row) {
+        probe_rows.push_back(static_cast<RowId>(probe_row));
+        build_rows.push_back(static_cast<RowId>(build_row));
+    }
+
+    void append(const JoinMatches& other) {
+        probe_rows.insert(probe_rows.end(), other.probe_rows.begin(), other.probe_rows.end());
+        build_rows.insert(build_rows.end(), other.build_rows.begin(), other.build_rows.end());
+    }
+};
 
-// NumPartitions is the number of partitions in the hash table, this is set to the number
-// of cores available on the system.
-constexpr size_t NumPartitions = 32;
+// Returns true if row ids of both join inputs can be stored as 32-bit integers.
+static inline bool fits_row_id32(const ColumnarTable& left, const ColumnarTable& right) {
+    constexpr size_t max_rows = static_cast<size_t>(std::numeric_limits<uint32_t>::max());
+    return left.num_rows <= max_rows && right.num_rows <= max_rows;
+}
 
 // Returns the offset within a page of a value of type T where T is restricted
 // to fixed length types since those are the only ones we expect to be used in
@@ -48,18 +330,98 @@ static inline bool get_bitmap(const uint8_t* bitmap, uint16_t idx) {
     return bitmap[byte_idx] & (1u << bit);
 }
 
-// --- Parallel Build Phase ---
+// Build sides with fewer rows than this are not sampled for heavy hitters.
+constexpr size_t HeavyHitterMinBuildRows = size_t{1} << 16;
+
+// Number of pages sampled and number of values sampled per page when looking
+// for heavy hitters.
+constexpr size_t HeavyHitterSamplePages    = 64;
+constexpr size_t HeavyHitterSamplesPerPage = 64;
+
+// A key is considered a heavy hitter if its estimated share of the build side
+// exceeds 1 / HeavyHitterShare.
+constexpr size_t HeavyHitterShare = 128;
+
+// HeavyHitters holds the build keys that own a large fraction of the build
+// rows (e.g. popular movie ids). They bypass the hash table so that probes do
+// not walk their very long chains, and their matches are expanded after the
+// probe with the work split evenly across threads.
 template <typename T>
-static void build_worker(size_t thread_id,        // Thread ID for pinning
-    const std::vector<Page*>&   pages_for_thread, // Pages assigned to this thread
-    size_t                      start_row_offset, // Global row index offset for the first page
-    PartitionedHashTable<T>&    ht_partitions,    // Shared partitioned hash table
-    std::vector<std::mutex>&    partition_mutexes // Mutexes for each partition
+struct HeavyHitters {
+    // Maps a heavy hitter key to its slot in `rows`.
+    flat_hash_map<T, uint32_t>       slots;
+    // Build row ids of every heavy hitter.
+    std::vector<std::vector<size_t>> rows;
+
+    bool empty() const { return slots.empty(); }
+
+    // Returns the slot of `key` or -1 if it is not a heavy hitter.
+    int64_t find(const T& key) const {
+        auto it = slots.find(key);
+        return it == slots.end() ? -1 : static_cast<int64_t>(it->second);
+    }
+};
+
+// HotProbes records probe rows that hit a heavy hitter, the matches are only
+// expanded once all probe threads are done.
+template <typename RowId>
+struct HotProbes {
+    std::vector<RowId>    probe_rows;
+    std::vector<uint32_t> slots;
+};
+
+// Samples the join column of the build side and returns its heavy hitters.
+// Pages are sampled evenly across the column and values evenly within a page
+// so that clustered inputs (e.g. sorted by movie_id) are sampled fairly.
+template <typename T>
+static HeavyHitters<T> sample_heavy_hitters(const Column& column, size_t num_rows) {
+    HeavyHitters<T> heavy_hitters;
+    if (num_rows < HeavyHitterMinBuildRows || column.pages.empty()) {
+        return heavy_hitters;
+    }
+
+    constexpr size_t data_offset = get_fixed_data_offset<T>();
+    size_t           page_step   = std::max<size_t>(1,
+        column.pages.size() / HeavyHitterSamplePages);
+    size_t                   num_samples = 0;
+    flat_hash_map<T, size_t> counts;
+    for (size_t page_idx = 0; page_idx < column.pages.size(); page_idx += page_step) {
+        const auto* page         = column.pages[page_idx];
+        uint16_t    num_non_null = *reinterpret_cast<const uint16_t*>(page->data + 2);
+        if (num_non_null == 0) {
+            continue;
+        }
+        const T* values     = reinterpret_cast<const T*>(page->data + data_offset);
+        size_t   value_step = std::max<size_t>(1, num_non_null / HeavyHitterSamplesPerPage);
+        for (size_t i = 0; i < num_non_null; i += value_step) {
+            ++counts[values[i]];
+            ++num_samples;
+        }
+    }
+
+    size_t min_count = std::max<size_t>(8, num_samples / HeavyHitterShare);
+    for (const auto& [key, count]: counts) {
+        if (count >= min_count) {
+            heavy_hitters.slots.emplace(key, static_cast<uint32_t>(heavy_hitters.rows.size()));
+            heavy_hitters.rows.emplace_back();
+        }
+    }
+    return heavy_hitters;
+}
+
+// --- Parallel Build Phase ---
+template <typename T, typename RowId>
+static void build_worker(size_t       thread_id,        // Thread ID for pinning
+    const std::vector<Page*>&         pages_for_thread, // Pages assigned to this thread
+    size_t                            start_row_offset, // Global row index offset for the first page
+    ConcurrentHashTable<T, RowId>&    ht,               // Shared hash table
+    const HeavyHitters<T>&            heavy_hitters,    // Keys stored outside the table
+    const uint64_t*                   key_hashes,       // Hashes of the keys, null if not known
+    std::vector<std::vector<size_t>>& hot_rows,         // Output: rows of heavy hitters
+    KeyRange<T>&                      key_range         // Output: range of inserted keys
 ) {
-    size_t                  current_row = start_row_offset;
-    constexpr size_t        data_offset = get_fixed_data_offset<T>();
-    PartitionedHashTable<T> local_partitions(NumPartitions);
-    std::hash<T>            hasher; // Hash function object
+    size_t           current_row = start_row_offset;
+    constexpr size_t data_offset = get_fixed_data_offset<T>();
 
     for (const auto* page: pages_for_thread) {
         uint16_t numrows = *reinterpret_cast<const uint16_t*>(page->data);
@@ -76,42 +438,44 @@ static void build_worker(size_t thread_id,        // Thread ID for pinning
             bool is_not_null = get_bitmap(bitmap, i);  // Assume get_bitmap exists
             if (is_not_null) {
                 const T& key = values[value_idx];      // Get the key
-                size_t   part_idx =
-                    hasher(key) & (NumPartitions - 1); // Calculate partition index
 
-                // Insert into thread local partition.
-                local_partitions[part_idx][key].emplace_back(current_row);
+                // Heavy hitters go to their dedicated storage.
+                int64_t hot_slot = heavy_hitters.empty() ? -1 : heavy_hitters.find(key);
+                if (hot_slot >= 0) [[unlikely]] {
+                    hot_rows[hot_slot].emplace_back(current_row);
+                } else {
+                    // Keys carried over from an earlier join come with their hash.
+                    uint64_t hash = key_hashes ? key_hashes[current_row] : hash_join_key(key);
+                    ht.insert(key, static_cast<RowId>(current_row), hash);
+                    if constexpr (std::is_integral_v<T>) {
+                        key_range.add(key);
+                    }
+                }
 
                 value_idx++; // Increment only for non-NULL
             }
             current_row++;   // Increment global row index for every slot
         }
     }
-
-    // Merge thread local results into the shared partitioned hash table.
-    for (size_t p_idx = 0; p_idx < NumPartitions; ++p_idx) {
-        if (!local_partitions[p_idx].empty()) {
-            // Acquire lock for the specific global partition.
-            std::lock_guard<std::mutex> lock(partition_mutexes[p_idx]);
-            // Merge local partition into the global partition.
-            auto& partition = ht_partitions[p_idx];
-            for (const auto& [key, rows]: local_partitions[p_idx]) {
-                partition[key].insert(partition[key].end(), rows.begin(), rows.end());
-            }
-        }
-    }
 }
 
-template <typename T>
-static void hash_join_build_partitioned(const ColumnarTable& table,
-    size_t                                                   join_col,
-    PartitionedHashTable<T>& ht_partitions,    // Output: partitioned hash table
-    std::vector<std::mutex>& partition_mutexes // Output: mutexes (created here)
+template <typename T, typename RowId>
+static void hash_join_build_parallel(const ColumnarTable& table,
+    size_t                                                join_col,
+    const uint64_t*                key_hashes,    // Hashes of the keys, null if not known
+    ConcurrentHashTable<T, RowId>& ht,            // Output: hash table sized for `table`
+    HeavyHitters<T>&               heavy_hitters, // Output: heavy hitters and their rows
+    KeyRange<T>&                   key_range      // Output: range of the keys in `ht`
 ) {
     const auto&  column      = table.columns[join_col];
     unsigned int num_threads = std::thread::hardware_concurrency();
 
-    ht_partitions.resize(NumPartitions);
+    heavy_hitters = sample_heavy_hitters<T>(column, table.num_rows);
+    // Every thread collects the rows of heavy hitters it sees locally, they are
+    // concatenated after the build so no lock is needed.
+    std::vector<std::vector<std::vector<size_t>>> thread_hot_rows(num_threads,
+        std::vector<std::vector<size_t>>(heavy_hitters.rows.size()));
+    std::vector<KeyRange<T>> thread_key_ranges(num_threads);
 
     std::vector<std::thread> threads;
     threads.reserve(num_threads);
@@ -141,12 +505,15 @@ static void hash_join_build_partitioned(const ColumnarTable& table,
         size_t start_row_for_thread = page_start_rows[start_page_idx];
 
         // Build the thread object and pin it to a core explicitly.
-        threads.emplace_back(build_worker<T>,
-            i,                           // Pin to core
-            std::move(pages_for_thread), // Pass pages chunk
-            start_row_for_thread,        // Pass starting global row index
-            std::ref(ht_partitions),     // Pass reference to shared partitions
-            std::ref(partition_mutexes)  // Pass reference to shared mutexes
+        threads.emplace_back(build_worker<T, RowId>,
+            i,                             // Pin to core
+            std::move(pages_for_thread),   // Pass pages chunk
+            start_row_for_thread,          // Pass starting global row index
+            std::ref(ht),                  // Pass reference to the shared table
+            std::cref(heavy_hitters),      // Pass heavy hitters (read-only)
+            key_hashes,                    // Pass carried key hashes
+            std::ref(thread_hot_rows[i]),  // Pass thread's heavy hitter rows
+            std::ref(thread_key_ranges[i]) // Pass thread's key range
         );
 
         start_page_idx = end_page_idx;
@@ -158,15 +525,124 @@ static void hash_join_build_partitioned(const ColumnarTable& table,
             t.join();
         }
     }
+
+    for (const auto& range: thread_key_ranges) {
+        key_range.merge(range);
+    }
+
+    // Concatenate the heavy hitter rows of all threads in thread order.
+    for (size_t slot = 0; slot < heavy_hitters.rows.size(); ++slot) {
+        auto&  rows  = heavy_hitters.rows[slot];
+        size_t total = 0;
+        for (const auto& local: thread_hot_rows) {
+            total += local[slot].size();
+        }
+        rows.reserve(total);
+        for (const auto& local: thread_hot_rows) {
+            rows.insert(rows.end(), local[slot].begin(), local[slot].end());
+        }
+    }
+}
+
+// Builds a SmallBuildTable from the join column of a tiny build side on the
+// calling thread, spawning threads would cost more than the build itself.
+template <typename T, typename RowId>
+static void hash_join_build_small(const ColumnarTable& table,
+    size_t                                             join_col,
+    SmallBuildTable<T, RowId>&                         small_table) {
+    const auto&                      column      = table.columns[join_col];
+    constexpr size_t                 data_offset = get_fixed_data_offset<T>();
+    std::vector<std::pair<T, RowId>> entries;
+    entries.reserve(table.num_rows);
+
+    size_t current_row = 0;
+    for (const auto* page: column.pages) {
+        uint16_t       numrows = *reinterpret_cast<const uint16_t*>(page->data);
+        const T*       values  = reinterpret_cast<const T*>(page->data + data_offset);
+        const uint8_t* bitmap =
+            reinterpret_cast<const uint8_t*>(page->data + PAGE_SIZE - (numrows + 7) / 8);
+        size_t value_idx = 0;
+        for (uint16_t i = 0; i < numrows; ++i, ++current_row) {
+            if (get_bitmap(bitmap, i)) {
+                entries.emplace_back(values[value_idx++], static_cast<RowId>(current_row));
+            }
+        }
+    }
+
+    std::sort(entries.begin(), entries.end());
+    small_table.keys.reserve(entries.size());
+    small_table.rows.reserve(entries.size());
+    for (const auto& [key, row]: entries) {
+        if (!small_table.keys.empty() && small_table.keys.back() == key) {
+            small_table.unique_keys = false;
+        }
+        small_table.keys.push_back(key);
+        small_table.rows.push_back(row);
+    }
+    if (small_table.use_block()) {
+        std::copy(small_table.keys.begin(), small_table.keys.end(), small_table.block.begin());
+    }
+}
+
+// Copies the rows of a chained table with unique keys into a dense table.
+template <typename T, typename RowId>
+static void fill_dense_key_table(const ConcurrentHashTable<T, RowId>& ht,
+    DenseKeyTable<T, RowId>&                                          dense) {
+    unsigned int num_threads = std::thread::hardware_concurrency();
+    if (num_threads == 0) {
+        num_threads = 1;
+    }
+
+    // Keys are unique so every thread writes to distinct slots.
+    auto fill = [&](size_t begin, size_t end) {
+        for (size_t bucket = begin; bucket < end; ++bucket) {
+            RowId row = ht.heads[bucket].load(std::memory_order_relaxed);
+            while (row != ht.EndOfChain) {
+                const auto& entry = ht.entries[row];
+                dense.rows[static_cast<uint64_t>(entry.key)
+                           - static_cast<uint64_t>(dense.min_key)] = row;
+                row = entry.next;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads);
+    size_t per_thread = (ht.num_buckets + num_threads - 1) / num_threads;
+    for (size_t begin = 0; begin < ht.num_buckets; begin += per_thread) {
+        threads.emplace_back(fill, begin, std::min(begin + per_thread, ht.num_buckets));
+    }
+    for (auto& t: threads) {
+        t.join();
+    }
 }
 
+template <typename RowId>
+struct FusedOutputRun;
+template <typename RowId>
+struct FusedOutput;
+
+// Fused probes write their buffered matches to the output pages once at least
+// this many are buffered.
+constexpr size_t FusedBatchRows = 1024;
+
 // --- Parallel Probe Phase ---
-template <typename T>
-static void probe_worker(size_t             thread_id, // Thread ID for pinning
-    const std::vector<Page*>&               pages_for_thread,
-    size_t                                  start_row_offset,
-    const PartitionedHashTable<T>&          ht_partitions, // Read-only access
-    std::vector<std::pair<size_t, size_t>>& thread_matches // Output for this thread
+//
+// HashTable is a ConcurrentHashTable, a SmallBuildTable or, when the build keys
+// are known to be unique, a DenseKeyTable. With unique keys every probe row has
+// at most one match and the probe loop has no inner loop over build rows.
+//
+// If `output_run` is set the matches are only buffered in small batches which
+// are written to the thread's output pages as the probe goes.
+template <typename T, typename RowId, bool UniqueKeys, typename HashTable>
+static void probe_worker(size_t thread_id, // Thread ID for pinning
+    const std::vector<Page*>&   pages_for_thread,
+    size_t                      start_row_offset,
+    const HashTable&            ht,             // Read-only access
+    const HeavyHitters<T>&      heavy_hitters,  // Read-only access
+    JoinMatches<RowId>&         thread_matches, // Output for this thread
+    HotProbes<RowId>&           thread_hot,     // Output: probes hitting heavy hitters
+    FusedOutputRun<RowId>*      output_run      // Output pages of a fused probe or null
 ) {
     // Pin this thread to a core.
     cpu_set_t cpuset;
@@ -177,7 +653,6 @@ static void probe_worker(size_t             thread_id, // Thread ID for pinning
 
     size_t           current_row = start_row_offset;
     constexpr size_t data_offset = get_fixed_data_offset<T>();
-    std::hash<T>     hasher;
 
     for (const auto* page: pages_for_thread) {
         uint16_t numrows = *reinterpret_cast<const uint16_t*>(page->data);
@@ -190,34 +665,131 @@ static void probe_worker(size_t             thread_id, // Thread ID for pinning
             reinterpret_cast<const uint8_t*>(page->data + PAGE_SIZE - (numrows + 7) / 8);
         size_t value_idx = 0;
 
-        for (uint16_t i = 0; i < numrows; ++i) {
-            bool is_not_null = get_bitmap(bitmap, i); // Assume get_bitmap exists
-            if (is_not_null) {
-                const T& key      = values[value_idx];
-                size_t   part_idx = hasher(key) & (NumPartitions - 1);
-
-                // Probe the *specific* partition (no lock needed for read)
-                const auto& partition = ht_partitions[part_idx];
-                auto        it        = partition.find(key);
+        if constexpr (UniqueKeys) {
+            // The match of every row is written unconditionally and only kept
+            // if the lookup hit, so no branch depends on the probe result.
+            size_t num_matches = thread_matches.size();
+            thread_matches.resize(num_matches + numrows);
+            for (uint16_t i = 0; i < numrows; ++i, ++current_row) {
+                if (get_bitmap(bitmap, i)) {
+                    RowId build_row = ht.find(values[value_idx++]);
+                    thread_matches.probe_rows[num_matches] = static_cast<RowId>(current_row);
+                    thread_matches.build_rows[num_matches] = build_row;
+                    num_matches += build_row != HashTable::NoMatch;
+                }
+            }
+            thread_matches.resize(num_matches);
+        } else {
+            for (uint16_t i = 0; i < numrows; ++i) {
+                bool is_not_null = get_bitmap(bitmap, i); // Assume get_bitmap exists
+                if (is_not_null) {
+                    const T& key = values[value_idx];
+
+                    // Defer heavy hitters, their matches are expanded in parallel.
+                    int64_t hot_slot = heavy_hitters.empty() ? -1 : heavy_hitters.find(key);
+                    if (hot_slot >= 0) [[unlikely]] {
+                        thread_hot.probe_rows.push_back(static_cast<RowId>(current_row));
+                        thread_hot.slots.push_back(static_cast<uint32_t>(hot_slot));
+                        value_idx++;
+                        current_row++;
+                        continue;
+                    }
 
-                if (it != partition.end()) {
-                    // Found matches in the build table partition
-                    for (size_t build_row: it->second) {
+                    // The table is read-only once built, no lock needed.
+                    ht.probe(key, [&](RowId build_row) {
                         thread_matches.emplace_back(current_row, build_row);
-                    }
+                    });
+                    value_idx++; // Increment only for non-NULL
                 }
-                value_idx++; // Increment only for non-NULL
+                current_row++;   // Increment global row index
             }
-            current_row++;   // Increment global row index
         }
+
+        if (output_run && thread_matches.size() >= FusedBatchRows) {
+            output_run->append(thread_matches);
+        }
+    }
+
+    if (output_run) {
+        output_run->append(thread_matches);
+        output_run->finalize();
     }
 }
 
-template <typename T>
-static void hash_join_probe_partitioned(const ColumnarTable& table,
-    size_t                                                   join_col,
-    const PartitionedHashTable<T>&          ht_partitions, // Input: Pre-built partitions
-    std::vector<std::pair<size_t, size_t>>& matches        // Output: All matches
+// Heavy hitter expansions producing fewer matches than this run on the calling
+// thread.
+constexpr size_t ParallelExpandMinMatches = size_t{1} << 14;
+
+// Appends the matches of all probes that hit a heavy hitter to `matches`.
+//
+// The output range is split evenly across threads instead of splitting the
+// probes, so that a single probe row matching a heavy hitter with millions of
+// build rows is still expanded by all threads together.
+template <typename T, typename RowId>
+static void expand_heavy_hitters(const HeavyHitters<T>& heavy_hitters,
+    const std::vector<HotProbes<RowId>>&                thread_hot,
+    JoinMatches<RowId>&                                 matches,
+    unsigned int                                        num_threads) {
+    HotProbes<RowId> hot;
+    for (const auto& local: thread_hot) {
+        hot.probe_rows.insert(hot.probe_rows.end(),
+            local.probe_rows.begin(),
+            local.probe_rows.end());
+        hot.slots.insert(hot.slots.end(), local.slots.begin(), local.slots.end());
+    }
+
+    // offsets[i] is the position of the first match of the i-th hot probe.
+    std::vector<size_t> offsets(hot.slots.size() + 1, 0);
+    for (size_t i = 0; i < hot.slots.size(); ++i) {
+        offsets[i + 1] = offsets[i] + heavy_hitters.rows[hot.slots[i]].size();
+    }
+    size_t total = offsets.back();
+    if (total == 0) {
+        return;
+    }
+
+    size_t base = matches.size();
+    matches.resize(base + total);
+
+    auto expand = [&](size_t begin, size_t end) {
+        size_t probe = std::upper_bound(offsets.begin(), offsets.end(), begin)
+                     - offsets.begin() - 1;
+        size_t out   = begin;
+        while (out < end) {
+            const auto& rows  = heavy_hitters.rows[hot.slots[probe]];
+            size_t      first = out - offsets[probe];
+            size_t      last  = std::min(rows.size(), end - offsets[probe]);
+            for (size_t k = first; k < last; ++k, ++out) {
+                matches.probe_rows[base + out] = hot.probe_rows[probe];
+                matches.build_rows[base + out] = static_cast<RowId>(rows[k]);
+            }
+            ++probe;
+        }
+    };
+
+    if (total < ParallelExpandMinMatches || num_threads <= 1) {
+        expand(0, total);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads);
+    size_t per_thread = (total + num_threads - 1) / num_threads;
+    for (size_t begin = 0; begin < total; begin += per_thread) {
+        threads.emplace_back(expand, begin, std::min(begin + per_thread, total));
+    }
+    for (auto& t: threads) {
+        t.join();
+    }
+}
+
+template <typename T, typename RowId, bool UniqueKeys, typename HashTable>
+static void hash_join_probe_parallel(const ColumnarTable& table,
+    size_t                                                join_col,
+    const HashTable&       ht,            // Input: Pre-built hash table
+    const HeavyHitters<T>& heavy_hitters, // Input: Heavy hitters of the build
+    JoinMatches<RowId>&    matches,       // Output: All matches
+    FusedOutput<RowId>*    fused_output   // Output: Pages of a fused probe or null
 ) {
     const auto&  column      = table.columns[join_col];
     unsigned int num_threads = std::thread::hardware_concurrency();
@@ -228,7 +800,8 @@ static void hash_join_probe_partitioned(const ColumnarTable& table,
     std::vector<std::thread> threads;
     threads.reserve(num_threads);
     // Create a vector to hold results from each thread
-    std::vector<std::vector<std::pair<size_t, size_t>>> thread_results(num_threads);
+    std::vector<JoinMatches<RowId>> thread_results(num_threads);
+    std::vector<HotProbes<RowId>>   thread_hot(num_threads);
 
     size_t total_pages      = column.pages.size();
     size_t pages_per_thread = (total_pages + num_threads - 1) / num_threads;
@@ -252,12 +825,15 @@ static void hash_join_probe_partitioned(const ColumnarTable& table,
         size_t             start_row_for_thread = page_start_rows[start_page_idx];
 
 
-        threads.emplace_back(probe_worker<T>,
+        threads.emplace_back(probe_worker<T, RowId, UniqueKeys, HashTable>,
             i, // Pin to core
             std::move(pages_for_thread),
             start_row_for_thread,
-            std::cref(ht_partitions),   // Pass const reference (read-only)
-            std::ref(thread_results[i]) // Pass reference to thread's result vector
+            std::cref(ht),               // Pass const reference (read-only)
+            std::cref(heavy_hitters),    // Pass const reference (read-only)
+            std::ref(thread_results[i]), // Pass reference to thread's result vector
+            std::ref(thread_hot[i]),     // Pass reference to thread's heavy hitter probes
+            fused_output ? &fused_output->runs[i] : nullptr // Thread's output pages
         );
         start_page_idx = end_page_idx;
     }
@@ -277,7 +853,19 @@ static void hash_join_probe_partitioned(const ColumnarTable& table,
     }
     matches.reserve(total_matches); // Reserve space in final vector
     for (const auto& results: thread_results) {
-        matches.insert(matches.end(), results.begin(), results.end());
+        matches.append(results);
+    }
+
+    if (!heavy_hitters.empty()) {
+        expand_heavy_hitters(heavy_hitters, thread_hot, matches, num_threads);
+    }
+}
+
+void ColumnarExecutor::charge_inputs(const Plan& plan) {
+    for (const auto& input: plan.inputs) {
+        for (const auto& column: input.columns) {
+            memory_in_use += column.pages.size() * PAGE_SIZE;
+        }
     }
 }
 
@@ -295,90 +883,6 @@ ColumnarTable ColumnarExecutor::execute_impl(const Plan& plan, size_t node_idx)
         node.data);
 }
 
-template <typename T>
-static void hash_join_build(const ColumnarTable& table,
-    size_t                                       join_col,
-    flat_hash_map<T, std::vector<size_t>>&       ht) {
-    auto&  column = table.columns[join_col];
-    size_t row    = 0;
-
-    // Iterate over each page and build the hash table from the
-    // column data.
-    for (auto* page: column.pages) {
-        uint16_t numrows     = *reinterpret_cast<uint16_t*>(page->data);
-        size_t   data_offset = 0;
-
-        // Since we only expect joins on fixed length types we can
-        // be sure we don't need to worry about strings which can
-        // span multiple pages.
-        if constexpr (sizeof(T) == 4) {
-            data_offset = 4;
-        } else {
-            data_offset = 8;
-        }
-
-        auto*  values = reinterpret_cast<T*>(page->data + data_offset);
-        auto*  bitmap = reinterpret_cast<uint8_t*>(page->data + PAGE_SIZE - (numrows + 7) / 8);
-        size_t value_idx = 0;
-
-        for (uint16_t i = 0; i < numrows; i++) {
-            bool is_not_null = get_bitmap(bitmap, i);
-            if (is_not_null) {
-                ht[values[value_idx]].emplace_back(row);
-                value_idx++;
-            }
-            row++;
-        }
-    }
-}
-
-template <typename T>
-static void hash_join_probe(const ColumnarTable& table,
-    size_t                                       join_col,
-    const flat_hash_map<T, std::vector<size_t>>& ht,
-    std::vector<std::pair<size_t, size_t>>&      matches) {
-    auto&  column = table.columns[join_col];
-    size_t row    = 0;
-
-    // Iterate over each page and build the hash table from the
-    // column data.
-    for (auto* page: column.pages) {
-        uint16_t numrows     = *reinterpret_cast<uint16_t*>(page->data);
-        size_t   data_offset = 0;
-
-        // Since we only expect joins on fixed length types we can
-        // be sure we don't need to worry about strings which can
-        // span multiple pages.
-        if constexpr (sizeof(T) == 4) {
-            data_offset = 4;
-        } else {
-            data_offset = 8;
-        }
-        // Since we only expect joins on fixed length types we can
-        // be sure we don't need to worry about strings which can
-        // span multiple pages.
-        auto*  values    = reinterpret_cast<T*>(page->data + data_offset);
-        size_t value_idx = 0;
-        auto*  bitmap = reinterpret_cast<uint8_t*>(page->data + PAGE_SIZE - (numrows + 7) / 8);
-
-        for (uint16_t i = 0; i < numrows; i++) {
-            bool is_not_null = get_bitmap(bitmap, i);
-            if (is_not_null) {
-                auto it = ht.find(values[value_idx]);
-                if (it != ht.end()) {
-                    for (auto match_row: it->second) {
-                        matches.emplace_back(row, match_row);
-                    }
-                }
-            }
-            row++;
-            if (is_not_null) {
-                value_idx++;
-            }
-        }
-    }
-}
-
 template <typename T>
 std::vector<std::optional<T>> extract_values_for_column(const ColumnarTable& table,
     size_t                                                                   column_idx) {
@@ -552,15 +1056,280 @@ std::vector<std::optional<T>> extract_values_for_column(const ColumnarTable& tab
     return values;
 }
 
-ColumnarTable build_result_columns(const std::vector<std::pair<size_t, size_t>>& matches,
-    const std::vector<std::tuple<size_t, DataType>>&                             output_attrs,
-    const ColumnarTable&                                                         left_result,
-    const ColumnarTable&                                                         right_result,
-    bool                                                                         build_left) {
+// Matches are clustered by groups of GatherClusterRows consecutive build rows
+// so that the values of one cluster stay in the L1 cache while gathering.
+constexpr size_t GatherClusterBits = 12;
+constexpr size_t GatherClusterRows = size_t{1} << GatherClusterBits;
+
+// Build sides with more rows than this do not fit in the L2 cache and are
+// gathered in clustered order when GatherOrder::Auto is used.
+constexpr size_t ClusteredGatherMinBuildRows = SPC__LEVEL2_CACHE_SIZE / sizeof(uint64_t);
+
+// Returns the positions of all matches ordered by the cluster their row id
+// falls into, this is a single counting sort pass over the row ids.
+template <typename RowId>
+static std::vector<uint32_t> cluster_match_positions(const std::vector<RowId>& rows,
+    size_t                                                                 num_rows) {
+    size_t              num_clusters = (num_rows + GatherClusterRows - 1) / GatherClusterRows;
+    std::vector<size_t> offsets(num_clusters + 1, 0);
+    for (RowId row: rows) {
+        ++offsets[(row >> GatherClusterBits) + 1];
+    }
+    for (size_t i = 1; i <= num_clusters; ++i) {
+        offsets[i] += offsets[i - 1];
+    }
+    std::vector<uint32_t> order(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        order[offsets[rows[i] >> GatherClusterBits]++] = static_cast<uint32_t>(i);
+    }
+    return order;
+}
+
+// Join outputs of at least this size are larger than the last level cache, and
+// are written with non-temporal stores so they don't evict the hash table.
+constexpr size_t StreamingOutputMinBytes = SPC__LEVEL3_CACHE_SIZE;
+
+// Returns the estimated size of an output row. Strings are estimated at 8 bytes
+// per value.
+static size_t output_row_bytes(const OutputAttrs& output_attrs) {
+    size_t row_bytes = 0;
+    for (auto [_, type]: output_attrs) {
+        row_bytes += type == DataType::INT32 ? sizeof(int32_t) : sizeof(int64_t);
+    }
+    return row_bytes;
+}
+
+// Returns true if `num_rows` output rows should be written with non-temporal
+// stores.
+static bool stream_output(size_t num_rows, const OutputAttrs& output_attrs) {
+    return num_rows * output_row_bytes(output_attrs) >= StreamingOutputMinBytes;
+}
+
+// Materializes a single output column by gathering the rows `source_rows` from
+// column `source_idx` of `source_result`.
+//
+// If `cluster_order` is provided the values are first gathered in that order,
+// which walks the source column almost sequentially, and scattered back into
+// match order before being appended to the output column.
+template <typename T, typename RowId>
+static void materialize_column(Column& dest_column,
+    const ColumnarTable&               source_result,
+    size_t                             source_idx,
+    const std::vector<RowId>&          source_rows,
+    const std::vector<uint32_t>*       cluster_order,
+    bool                               streaming) {
+    using Value = std::conditional_t<std::is_same_v<T, std::string>, std::string_view, T>;
+
+    auto inserter   = ColumnInserter<T>(dest_column, streaming);
+    auto row_values = extract_values_for_column<T>(source_result, source_idx);
+
+    if (cluster_order) {
+        std::vector<std::optional<Value>> gathered(source_rows.size());
+        for (uint32_t pos: *cluster_order) {
+            RowId row_idx = source_rows[pos];
+            if (row_idx < row_values.size() && row_values[row_idx].has_value()) {
+                gathered[pos] = Value(row_values[row_idx].value());
+            }
+        }
+        for (const auto& value: gathered) {
+            if (value.has_value()) {
+                inserter.insert(value.value());
+            } else {
+                inserter.insert_null();
+            }
+        }
+    } else {
+        // Insert values based on matches
+        for (RowId row_idx: source_rows) {
+            if (row_idx < row_values.size() && row_values[row_idx].has_value()) {
+                inserter.insert(row_values[row_idx].value());
+            } else {
+                inserter.insert_null();
+            }
+        }
+    }
+
+    inserter.finalize();
+}
+
+// --- Fused probe and materialization ---
+//
+// The root join and joins with a narrow output do not build the match list:
+// every probe thread appends the output values of its matches to its own run of
+// output pages, and the runs are concatenated in thread order at the end.
+
+// Joins with at most this many output columns are fused anywhere in the plan.
+constexpr size_t FusedMaxOutputColumns = 2;
+
+using DecodedColumn = std::variant<std::vector<std::optional<int32_t>>,
+    std::vector<std::optional<int64_t>>,
+    std::vector<std::optional<double>>,
+    std::vector<std::optional<std::string>>>;
+
+// OutputColumnWriter appends the values of one output column for a batch of
+// matches.
+template <typename RowId>
+struct OutputColumnWriter {
+    virtual ~OutputColumnWriter() = default;
+
+    virtual void append(const JoinMatches<RowId>& batch) = 0;
+    virtual void finalize()                              = 0;
+};
+
+template <typename T, typename RowId>
+struct TypedOutputColumnWriter: OutputColumnWriter<RowId> {
+    const std::vector<std::optional<T>>& values;
+    bool                                 from_build;
+    ColumnInserter<T>                    inserter;
+
+    TypedOutputColumnWriter(const std::vector<std::optional<T>>& values,
+        bool                                                     from_build,
+        Column&                                                  column,
+        bool                                                     streaming)
+    : values(values)
+    , from_build(from_build)
+    , inserter(column, streaming) {}
+
+    void append(const JoinMatches<RowId>& batch) override {
+        const auto& rows = from_build ? batch.build_rows : batch.probe_rows;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            RowId row_idx = rows[i];
+            if (row_idx < values.size() && values[row_idx].has_value()) {
+                inserter.insert(values[row_idx].value());
+            } else {
+                inserter.insert_null();
+            }
+        }
+    }
+
+    void finalize() override { inserter.finalize(); }
+};
+
+// FusedOutputRun is the output of a single probe thread.
+template <typename RowId>
+struct FusedOutputRun {
+    std::vector<Column>                                     columns;
+    std::vector<std::unique_ptr<OutputColumnWriter<RowId>>> writers;
+    size_t                                                  num_rows = 0;
+
+    // Writes the matches of `batch` to the output pages and empties it.
+    void append(JoinMatches<RowId>& batch) {
+        for (auto& writer: writers) {
+            writer->append(batch);
+        }
+        num_rows += batch.size();
+        batch.resize(0);
+    }
+
+    void finalize() {
+        for (auto& writer: writers) {
+            writer->finalize();
+        }
+    }
+};
+
+// FusedOutput holds the decoded source columns of the output and the runs of
+// the probe threads.
+template <typename RowId>
+struct FusedOutput {
+    std::vector<DataType>              types;
+    std::vector<size_t>                source_columns;
+    std::vector<bool>                  from_build;
+    // Decoded source of every output column, shared by all threads.
+    std::vector<DecodedColumn>         sources;
+    std::vector<FusedOutputRun<RowId>> runs;
+
+    FusedOutput(const OutputAttrs& output_attrs, size_t num_left_columns, bool build_left)
+    : sources(output_attrs.size()) {
+        for (auto [attr_idx, type]: output_attrs) {
+            bool from_left = attr_idx < num_left_columns;
+            types.push_back(type);
+            source_columns.push_back(from_left ? attr_idx : attr_idx - num_left_columns);
+            from_build.push_back(from_left == build_left);
+        }
+    }
+
+    // Decodes the output columns that come from the build side if `build_side`
+    // is set and from the probe side otherwise.
+    void decode(const ColumnarTable& table, bool build_side) {
+        for (size_t i = 0; i < types.size(); ++i) {
+            if (from_build[i] == build_side) {
+                DISPATCH_DATA_TYPE(types[i], T, {
+                    sources[i] = extract_values_for_column<T>(table, source_columns[i]);
+                });
+            }
+        }
+    }
+
+    // Creates the output runs of `num_threads` probe threads.
+    void start(size_t num_threads, bool streaming) {
+        runs.clear();
+        runs.resize(num_threads);
+        // The writers keep references to their column, so the columns are
+        // never reallocated once the writers exist.
+        for (auto& run: runs) {
+            run.columns.reserve(types.size());
+            for (size_t i = 0; i < types.size(); ++i) {
+                run.columns.emplace_back(types[i]);
+                DISPATCH_DATA_TYPE(types[i], T, {
+                    using Writer = TypedOutputColumnWriter<T, RowId>;
+                    run.writers.emplace_back(std::make_unique<Writer>(
+                        std::get<std::vector<std::optional<T>>>(sources[i]),
+                        from_build[i],
+                        run.columns.back(),
+                        streaming));
+                });
+            }
+        }
+    }
+
+    // Concatenates the runs of all threads into the join result.
+    ColumnarTable finish() {
+        ColumnarTable result;
+        result.columns.reserve(types.size());
+        for (auto type: types) {
+            result.columns.emplace_back(type);
+        }
+        for (auto& run: runs) {
+            result.num_rows += run.num_rows;
+            for (size_t i = 0; i < run.columns.size(); ++i) {
+                auto& pages     = result.columns[i].pages;
+                auto& run_pages = run.columns[i].pages;
+                pages.insert(pages.end(), run_pages.begin(), run_pages.end());
+                run_pages.clear();
+            }
+        }
+        runs.clear();
+        return result;
+    }
+};
+
+template <typename RowId>
+ColumnarTable build_result_columns(const JoinMatches<RowId>& matches,
+    const std::vector<std::tuple<size_t, DataType>>&         output_attrs,
+    const ColumnarTable&                                     left_result,
+    const ColumnarTable&                                     right_result,
+    bool                                                     build_left,
+    GatherOrder                                              gather_order) {
     ColumnarTable result;
     result.num_rows = matches.size();
     result.columns.reserve(output_attrs.size());
 
+    // Decide whether build side columns are gathered in clustered order, the
+    // cluster order is computed once and shared by all build side columns.
+    const auto& build_result = build_left ? left_result : right_result;
+    if (gather_order == GatherOrder::Auto) {
+        gather_order = build_result.num_rows > ClusteredGatherMinBuildRows
+                         ? GatherOrder::Clustered
+                         : GatherOrder::OrderPreserving;
+    }
+    if (matches.size() > std::numeric_limits<uint32_t>::max()) {
+        gather_order = GatherOrder::OrderPreserving;
+    }
+    std::vector<uint32_t> cluster_order;
+    bool                  cluster_order_ready = false;
+    bool                  streaming           = stream_output(matches.size(), output_attrs);
+
     // For each output column
     for (auto [attr_idx, type]: output_attrs) {
         // Determine source column
@@ -576,111 +1345,197 @@ ColumnarTable build_result_columns(const std::vector<std::pair<size_t, size_t>>&
         }
 
         const auto& source_result = from_left ? left_result : right_result;
+        // Row ids of the side the column comes from, the build side is the left
+        // one iff we built on the left.
+        bool        from_build  = from_left == build_left;
+        const auto& source_rows = from_build ? matches.build_rows : matches.probe_rows;
+
+        // Probe side rows are produced in (almost) ascending order so only the
+        // build side benefits from clustering.
+        const std::vector<uint32_t>* order = nullptr;
+        if (from_build && gather_order == GatherOrder::Clustered) {
+            if (!cluster_order_ready) {
+                cluster_order =
+                    cluster_match_positions(matches.build_rows, build_result.num_rows);
+                cluster_order_ready = true;
+            }
+            order = &cluster_order;
+        }
 
         // Create a new column of the appropriate type
         result.columns.emplace_back(type);
         auto& dest_column = result.columns.back();
 
-        // Create the appropriate column inserter and extract values based on type
-        switch (type) {
-        case DataType::INT32: {
-            auto inserter   = ColumnInserter<int32_t>(dest_column);
-            auto row_values = extract_values_for_column<int32_t>(source_result, source_idx);
-
-            // Insert values based on matches
-            for (const auto& [left_row, right_row]: matches) {
-                size_t row_idx = from_left ? left_row : right_row;
-                if (row_idx < row_values.size() && row_values[row_idx].has_value()) {
-                    inserter.insert(row_values[row_idx].value());
-                } else {
-                    inserter.insert_null();
-                }
-            }
+        DISPATCH_DATA_TYPE(type, T, {
+            materialize_column<T>(dest_column,
+                source_result,
+                source_idx,
+                source_rows,
+                order,
+                streaming);
+        });
+    }
 
-            inserter.finalize();
-            break;
-        }
-        case DataType::INT64: {
-            auto inserter   = ColumnInserter<int64_t>(dest_column);
-            auto row_values = extract_values_for_column<int64_t>(source_result, source_idx);
-
-            // Insert values based on matches
-            for (const auto& [left_row, right_row]: matches) {
-                size_t row_idx = from_left ? left_row : right_row;
-                if (row_idx < row_values.size() && row_values[row_idx].has_value()) {
-                    inserter.insert(row_values[row_idx].value());
-                } else {
-                    inserter.insert_null();
-                }
-            }
+    return result;
+}
 
-            inserter.finalize();
-            break;
+// JoinBuild is the hash table of the build side of a join on a column of type
+// T, built once and probed by any number of probe tables. Keys whose hashes an
+// earlier join carried over are not hashed again.
+template <typename T, typename RowId>
+struct JoinBuild {
+    HeavyHitters<T>                                heavy_hitters;
+    std::unique_ptr<SmallBuildTable<T, RowId>>     small_table;
+    std::unique_ptr<ConcurrentHashTable<T, RowId>> hash_table;
+    std::unique_ptr<DenseKeyTable<T, RowId>>       dense_table;
+    // Build sides with unique keys have at most one match per probe row.
+    bool unique_keys = false;
+
+    JoinBuild(const ColumnarTable& build_table,
+        size_t                     build_join_col,
+        const uint64_t*            build_hashes) {
+        // Tiny build sides skip the parallel build altogether.
+        if (build_table.num_rows <= SmallBuildMaxRows) {
+            small_table = std::make_unique<SmallBuildTable<T, RowId>>();
+            hash_join_build_small(build_table, build_join_col, *small_table);
+            unique_keys = small_table->unique_keys;
+            return;
         }
-        case DataType::FP64: {
-            auto inserter   = ColumnInserter<double>(dest_column);
-            auto row_values = extract_values_for_column<double>(source_result, source_idx);
-
-            // Insert values based on matches
-            for (const auto& [left_row, right_row]: matches) {
-                size_t row_idx = from_left ? left_row : right_row;
-                if (row_idx < row_values.size() && row_values[row_idx].has_value()) {
-                    inserter.insert(row_values[row_idx].value());
-                } else {
-                    inserter.insert_null();
-                }
-            }
 
-            inserter.finalize();
-            break;
+        hash_table = std::make_unique<ConcurrentHashTable<T, RowId>>(build_table.num_rows);
+        KeyRange<T> key_range;
+        hash_join_build_parallel<T, RowId>(build_table,
+            build_join_col,
+            build_hashes,
+            *hash_table,
+            heavy_hitters,
+            key_range);
+        unique_keys = heavy_hitters.empty() && hash_table->unique_keys.load();
+        if (unique_keys && DenseKeyTable<T, RowId>::fits(key_range)) {
+            dense_table = std::make_unique<DenseKeyTable<T, RowId>>(key_range);
+            fill_dense_key_table(*hash_table, *dense_table);
+            hash_table.reset();
         }
-        case DataType::VARCHAR: {
-            auto inserter   = ColumnInserter<std::string>(dest_column);
-            auto row_values = extract_values_for_column<std::string>(source_result, source_idx);
-
-            // Insert values based on matches
-            for (const auto& [left_row, right_row]: matches) {
-                size_t row_idx = from_left ? left_row : right_row;
-                if (row_idx < row_values.size() && row_values[row_idx].has_value()) {
-                    inserter.insert(row_values[row_idx].value());
-                } else {
-                    inserter.insert_null();
-                }
-            }
+    }
 
-            inserter.finalize();
-            break;
+    // Returns true if probes hash their keys.
+    bool hashes_keys() const { return hash_table != nullptr; }
+
+    // Calls `probe(unique_keys, table)` with the table to probe, `unique_keys`
+    // is std::true_type if every key has at most one build row.
+    template <typename F>
+    auto visit(F&& probe) const {
+        if (dense_table) {
+            return probe(std::true_type{}, *dense_table);
+        }
+        if (small_table && unique_keys) {
+            return probe(std::true_type{}, *small_table);
         }
+        if (small_table) {
+            return probe(std::false_type{}, *small_table);
         }
+        if (unique_keys) {
+            return probe(std::true_type{}, *hash_table);
+        }
+        return probe(std::false_type{}, *hash_table);
     }
-
-    return result;
+};
+
+// Runs the parallel hash join on a join column of type T and stores the
+// matches with row ids of type RowId.
+template <typename T, typename RowId>
+static ColumnarTable execute_join_parallel(const ColumnarTable& build_table,
+    const ColumnarTable&                                        probe_table,
+    size_t                                                      build_join_col,
+    const uint64_t*                                             build_hashes,
+    size_t                                                      probe_join_col,
+    const OutputAttrs&                                          output_attrs,
+    const ColumnarTable&                                        left_result,
+    const ColumnarTable&                                        right_result,
+    bool                                                        build_left,
+    GatherOrder                                                 gather_order,
+    bool                                                        fuse_output) {
+    // Step 1: Build the hash table from the build table.
+    JoinBuild<T, RowId> build(build_table, build_join_col, build_hashes);
+    JoinMatches<RowId>  matches;
+
+    // Step 2: Probe the hash table with the probe table and build the result
+    // columns, either from the match list or straight from the probe threads.
+    // Heavy hitters are expanded from the match list, so joins with heavy
+    // hitters are never fused.
+    return build.visit([&](auto unique_keys, const auto& table) {
+        constexpr bool UniqueKeys = decltype(unique_keys)::value;
+        if (fuse_output && build.heavy_hitters.empty()) {
+            // The output size is not known before the probe, the size of the
+            // probe side is used to decide whether to stream the output.
+            FusedOutput<RowId> fused_output(output_attrs,
+                left_result.columns.size(),
+                build_left);
+            fused_output.decode(build_table, true);
+            fused_output.decode(probe_table, false);
+            fused_output.start(std::max(1u, std::thread::hardware_concurrency()),
+                stream_output(probe_table.num_rows, output_attrs));
+            hash_join_probe_parallel<T, RowId, UniqueKeys>(probe_table,
+                probe_join_col,
+                table,
+                build.heavy_hitters,
+                matches,
+                &fused_output);
+            return fused_output.finish();
+        }
+        hash_join_probe_parallel<T, RowId, UniqueKeys>(probe_table,
+            probe_join_col,
+            table,
+            build.heavy_hitters,
+            matches,
+            nullptr);
+        return build_result_columns(matches,
+            output_attrs,
+            left_result,
+            right_result,
+            build_left,
+            gather_order);
+    });
 }
 
+// Dispatches to the narrowest row id type that can address both join inputs.
+// `build_hashes` holds the hashes of the build keys if they are known.
 template <typename T>
-static ColumnarTable execute_join_impl(const ColumnarTable& build_table,
-    const ColumnarTable&                                    probe_table,
-    size_t                                                  build_join_col,
-    size_t                                                  probe_join_col,
-    const OutputAttrs&                                      output_attrs,
-    const ColumnarTable&                                    left_results,
-    const ColumnarTable&                                    right_results) {
-    flat_hash_map<T, std::vector<size_t>> ht;
-
-    // Step 1: Build the hash table from the build table.
-    hash_join_build<T>(build_table, build_join_col, ht);
-    // Step 2: Probe the hash table with the probe table.
-    std::vector<std::pair<size_t, size_t>> matches;
-    hash_join_probe<T>(probe_table, probe_join_col, ht, matches);
-    matches.reserve(build_table.num_rows);
-    // Step 3: Build the result columns based on the matches.
-    ColumnarTable result = build_result_columns(matches,
+static ColumnarTable execute_join_typed(const ColumnarTable& build_table,
+    const ColumnarTable&                                     probe_table,
+    size_t                                                   build_join_col,
+    const uint64_t*                                          build_hashes,
+    size_t                                                   probe_join_col,
+    const OutputAttrs&                                       output_attrs,
+    const ColumnarTable&                                     left_result,
+    const ColumnarTable&                                     right_result,
+    bool                                                     build_left,
+    GatherOrder                                              gather_order,
+    bool                                                     fuse_output) {
+    if (fits_row_id32(left_result, right_result)) {
+        return execute_join_parallel<T, uint32_t>(build_table,
+            probe_table,
+            build_join_col,
+            build_hashes,
+            probe_join_col,
+            output_attrs,
+            left_result,
+            right_result,
+            build_left,
+            gather_order,
+            fuse_output);
+    }
+    return execute_join_parallel<T, uint64_t>(build_table,
+        probe_table,
+        build_join_col,
+        build_hashes,
+        probe_join_col,
         output_attrs,
-        left_results,
-        right_results,
-        build_table.num_rows == left_results.num_rows);
-    // Step 4: Return the result.
-    return result;
+        left_result,
+        right_result,
+        build_left,
+        gather_order,
+        fuse_output);
 }
 
 ColumnarTable ColumnarExecutor::execute_scan(const Plan& plan,
@@ -711,15 +1566,1339 @@ ColumnarTable ColumnarExecutor::execute_scan(const Plan& plan,
     return results;
 }
 
-ColumnarTable ColumnarExecutor::execute_join(const Plan& plan,
-    const JoinNode&                                      join,
-    const OutputAttrs&                                   output_attrs) {
-    auto left  = join.left;
-    auto right = join.right;
+// JoinInput holds the input of a join. Scans are not executed: their output
+// columns share the pages of the base table, so the join hashes and gathers
+// straight from the loaded table instead of a copy of it. Borrowed pages are
+// handed back instead of freed when the input goes away.
+//
+// Owned pages and key hashes are charged to the memory in use of the executor
+// until the input is released.
+struct JoinInput {
+    ColumnarTable                      table;
+    bool                               borrowed      = false;
+    size_t*                            charged_to    = nullptr;
+    size_t                             charged_bytes = 0;
+    std::optional<Partitioning>        partitioning;
+    // Key hashes carried over from the pipeline that produced the input, per
+    // column, empty for columns without.
+    std::vector<std::vector<uint64_t>> hashes;
+
+    JoinInput() = default;
+
+    JoinInput(const JoinInput&)            = delete;
+    JoinInput& operator=(const JoinInput&) = delete;
+
+    ~JoinInput() { release(); }
+
+    void charge(size_t& memory_in_use) {
+        for (const auto& column: table.columns) {
+            charged_bytes += column.pages.size() * PAGE_SIZE;
+        }
+        for (const auto& column_hashes: hashes) {
+            charged_bytes += column_hashes.size() * sizeof(uint64_t);
+        }
+        memory_in_use += charged_bytes;
+        charged_to     = &memory_in_use;
+    }
+
+    void release() {
+        if (borrowed) {
+            for (auto& column: table.columns) {
+                column.pages.clear();
+            }
+        }
+        table.columns.clear();
+        table.num_rows = 0;
+        borrowed = false;
+        partitioning.reset();
+        hashes.clear();
+        if (charged_to) {
+            *charged_to   -= charged_bytes;
+            charged_to     = nullptr;
+            charged_bytes  = 0;
+        }
+    }
+};
+
+static void execute_join_input(ColumnarExecutor& executor,
+    const Plan&                                  plan,
+    size_t                                       node_idx,
+    JoinInput&                                   input) {
+    const auto& node = plan.nodes[node_idx];
+    if (const auto* scan = std::get_if<ScanNode>(&node.data)) {
+        const auto& base     = plan.inputs[scan->base_table_id];
+        input.borrowed       = true;
+        input.table.num_rows = base.num_rows;
+        input.table.columns.reserve(node.output_attrs.size());
+        for (auto [source_col_idx, type]: node.output_attrs) {
+            assert(source_col_idx < base.columns.size());
+            input.table.columns.emplace_back(type);
+            input.table.columns.back().pages = base.columns[source_col_idx].pages;
+        }
+    } else {
+        executor.output_partitioning.reset();
+        executor.output_hashes.clear();
+        input.table        = executor.execute_impl(plan, node_idx);
+        input.partitioning = std::exchange(executor.output_partitioning, std::nullopt);
+        input.hashes       = std::exchange(executor.output_hashes, {});
+        input.charge(executor.memory_in_use);
+    }
+}
+
+// Returns the carried hashes of the keys in `join_col` of `input`, null if
+// there are none.
+static const uint64_t* input_key_hashes(const JoinInput& input, size_t join_col) {
+    if (join_col >= input.hashes.size() || input.hashes[join_col].empty()) {
+        return nullptr;
+    }
+    return input.hashes[join_col].data();
+}
+
+// --- Grace hash join ---
+//
+// Joins whose hash table does not fit in the memory budget partition both
+// inputs by key hash into temporary files on local disk, release the inputs
+// and then join one pair of partitions at a time.
+
+// Rough size of the hash table per build row: its entry and bucket head.
+constexpr size_t HashTableBytesPerRow = 4 * sizeof(uint64_t);
+// Rough size of a match: its probe and build row ids.
+constexpr size_t MatchBytes = 2 * sizeof(uint64_t);
+constexpr size_t GraceMinPartitions   = 2;
+constexpr size_t GraceMaxPartitions   = 1024;
+// Rows scattered to the partitions between two flushes of their full pages.
+constexpr size_t GraceFlushRows = 4096;
+
+// Returns the memory needed by a join besides its inputs: its hash table, its
+// matches and its output. The output size is not known before the probe, the
+// probe side is assumed to match once per row.
+static size_t join_memory_bytes(size_t build_rows,
+    size_t                             probe_rows,
+    const OutputAttrs&                 output_attrs) {
+    size_t hash_table_bytes = build_rows > SmallBuildMaxRows
+                                ? build_rows * HashTableBytesPerRow
+                                : 0;
+    return hash_table_bytes + probe_rows * (MatchBytes + output_row_bytes(output_attrs));
+}
+
+size_t ColumnarExecutor::default_memory_budget() {
+    // Leave the other half to the OS, the table cache and the estimates being off.
+    size_t physical = static_cast<size_t>(sysconf(_SC_PHYS_PAGES))
+                    * static_cast<size_t>(sysconf(_SC_PAGE_SIZE));
+    return physical / 2;
+}
+
+// SpillFile is a temporary file holding one partition of a join input. Pages
+// are appended in any order and read back column by column, the file is
+// removed by the OS once closed.
+struct SpillFile {
+    FILE*                            file      = nullptr;
+    size_t                           num_pages = 0;
+    size_t                           num_rows  = 0;
+    std::vector<std::vector<size_t>> column_pages;
+
+    explicit SpillFile(size_t num_columns)
+    : file(std::tmpfile())
+    , column_pages(num_columns) {
+        if (!file) {
+            throw std::runtime_error("Cannot create a spill file for a grace hash join");
+        }
+    }
+
+    SpillFile(SpillFile&& other) noexcept
+    : file(other.file)
+    , num_pages(other.num_pages)
+    , num_rows(other.num_rows)
+    , column_pages(std::move(other.column_pages)) {
+        other.file = nullptr;
+    }
+
+    SpillFile(const SpillFile&)            = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    ~SpillFile() {
+        if (file) {
+            std::fclose(file);
+        }
+    }
+
+    void write(size_t column_idx, const Page* page) {
+        if (std::fwrite(page->data, PAGE_SIZE, 1, file) != 1) {
+            throw std::runtime_error("Cannot write to a spill file");
+        }
+        column_pages[column_idx].push_back(num_pages++);
+    }
+
+    void read(size_t column_idx, Column& column) {
+        for (size_t page_idx: column_pages[column_idx]) {
+            auto* page = column.new_page();
+            if (std::fseek(file, static_cast<long>(page_idx * PAGE_SIZE), SEEK_SET) != 0
+                || std::fread(page->data, PAGE_SIZE, 1, file) != 1) {
+                throw std::runtime_error("Cannot read from a spill file");
+            }
+        }
+    }
+};
+
+// Writes the full pages of `inserter` to `file` and drops them from memory, the
+// page being filled stays.
+template <typename T>
+static void
+flush_spilled_pages(ColumnInserter<T>& inserter, SpillFile& file, size_t column_idx) {
+    auto& pages = inserter.column.pages;
+    for (size_t i = 0; i < inserter.last_page_idx; ++i) {
+        file.write(column_idx, pages[i]);
+        delete pages[i];
+    }
+    pages.erase(pages.begin(), pages.begin() + inserter.last_page_idx);
+    inserter.last_page_idx = 0;
+}
+
+// Scatters the rows of column `column_idx` to the partitions in `files`.
+template <typename T>
+static void spill_column(const ColumnarTable& table,
+    size_t                                    column_idx,
+    const std::vector<uint32_t>&              row_partitions,
+    std::vector<SpillFile>&                   files) {
+    auto values = extract_values_for_column<T>(table, column_idx);
+
+    std::vector<Column>            columns;
+    std::vector<ColumnInserter<T>> inserters;
+    columns.reserve(files.size());
+    inserters.reserve(files.size());
+    for (size_t i = 0; i < files.size(); ++i) {
+        columns.emplace_back(table.columns[column_idx].type);
+        inserters.emplace_back(columns.back());
+    }
+
+    for (size_t row = 0; row < row_partitions.size(); ++row) {
+        uint32_t partition = row_partitions[row];
+        if (partition < files.size()) {
+            if (row < values.size() && values[row].has_value()) {
+                inserters[partition].insert(values[row].value());
+            } else {
+                inserters[partition].insert_null();
+            }
+        }
+        if ((row + 1) % GraceFlushRows == 0) {
+            for (size_t i = 0; i < files.size(); ++i) {
+                flush_spilled_pages(inserters[i], files[i], column_idx);
+            }
+        }
+    }
+    for (size_t i = 0; i < files.size(); ++i) {
+        inserters[i].finalize();
+        flush_spilled_pages(inserters[i], files[i], column_idx);
+    }
+}
+
+// Partitions the rows of `table` by the hash of their key in `join_col` and
+// writes the columns set in `needed` to one spill file per partition. Keys are
+// only hashed if `key_hashes` does not hold their hashes. Rows with a null key
+// never match and are dropped.
+template <typename T>
+static std::vector<SpillFile> spill_partitions(const ColumnarTable& table,
+    size_t                                                          join_col,
+    const uint64_t*                                                 key_hashes,
+    const std::vector<bool>&                                        needed,
+    size_t                                                          num_partitions) {
+    constexpr size_t   data_offset = get_fixed_data_offset<T>();
+    constexpr uint32_t NullKey     = std::numeric_limits<uint32_t>::max();
+
+    std::vector<SpillFile> files;
+    files.reserve(num_partitions);
+    for (size_t i = 0; i < num_partitions; ++i) {
+        files.emplace_back(table.columns.size());
+    }
+
+    std::vector<uint32_t> row_partitions;
+    row_partitions.reserve(table.num_rows);
+    for (const auto* page: table.columns[join_col].pages) {
+        uint16_t       numrows = *reinterpret_cast<const uint16_t*>(page->data);
+        const T*       values  = reinterpret_cast<const T*>(page->data + data_offset);
+        const uint8_t* bitmap =
+            reinterpret_cast<const uint8_t*>(page->data + PAGE_SIZE - (numrows + 7) / 8);
+        size_t value_idx = 0;
+        for (uint16_t i = 0; i < numrows; ++i) {
+            if (get_bitmap(bitmap, i)) {
+                uint64_t hash      = key_hashes ? key_hashes[row_partitions.size()]
+                                                : hash_join_key(values[value_idx]);
+                auto     partition = static_cast<uint32_t>(hash & (num_partitions - 1));
+                ++value_idx;
+                row_partitions.push_back(partition);
+                ++files[partition].num_rows;
+            } else {
+                row_partitions.push_back(NullKey);
+            }
+        }
+    }
+
+    for (size_t column_idx = 0; column_idx < table.columns.size(); ++column_idx) {
+        if (needed[column_idx]) {
+            DISPATCH_DATA_TYPE(table.columns[column_idx].type, V, {
+                spill_column<V>(table, column_idx, row_partitions, files);
+            });
+        }
+    }
+    return files;
+}
+
+// Writes the partitions of a table that is already partitioned on its join key
+// to one spill file each. Partitions are runs of pages, so they are copied page
+// by page without looking at a single key.
+static std::vector<SpillFile> spill_partitioned(const ColumnarTable& table,
+    const Partitioning&                                              partitioning,
+    const std::vector<bool>&                                         needed) {
+    size_t                 num_partitions = partitioning.partition_rows.size();
+    std::vector<SpillFile> files;
+    files.reserve(num_partitions);
+    std::vector<size_t> first_pages(table.columns.size(), 0);
+    for (size_t i = 0; i < num_partitions; ++i) {
+        auto& file    = files.emplace_back(table.columns.size());
+        file.num_rows = partitioning.partition_rows[i];
+        for (size_t column_idx = 0; column_idx < table.columns.size(); ++column_idx) {
+            size_t num_pages = partitioning.partition_pages[i][column_idx];
+            if (needed[column_idx]) {
+                const auto& pages = table.columns[column_idx].pages;
+                for (size_t page_idx = 0; page_idx < num_pages; ++page_idx) {
+                    file.write(column_idx, pages[first_pages[column_idx] + page_idx]);
+                }
+            }
+            first_pages[column_idx] += num_pages;
+        }
+    }
+    return files;
+}
+
+// Returns the number of partitions of `input` if it is partitioned on
+// `join_col`, 0 otherwise.
+static size_t input_partitions(const JoinInput& input, size_t join_col) {
+    if (!input.partitioning) {
+        return 0;
+    }
+    const auto& key_columns = input.partitioning->key_columns;
+    if (std::find(key_columns.begin(), key_columns.end(), join_col) == key_columns.end()) {
+        return 0;
+    }
+    return input.partitioning->partition_rows.size();
+}
+
+// Reads a partition back, columns that were not spilled stay empty.
+static ColumnarTable read_partition(SpillFile& file, const std::vector<DataType>& types) {
+    ColumnarTable partition;
+    partition.num_rows = file.num_rows;
+    partition.columns.reserve(types.size());
+    for (size_t column_idx = 0; column_idx < types.size(); ++column_idx) {
+        partition.columns.emplace_back(types[column_idx]);
+        file.read(column_idx, partition.columns.back());
+    }
+    return partition;
+}
+
+// Returns the number of partitions such that a single partition of `bytes`
+// takes at most half of `available` bytes.
+static size_t grace_partitions(size_t bytes, size_t available) {
+    size_t num_partitions = GraceMinPartitions;
+    while (num_partitions < GraceMaxPartitions && bytes / num_partitions > available / 2) {
+        num_partitions *= 2;
+    }
+    return num_partitions;
+}
+
+// Runs a join as a grace hash join over `num_partitions` partitions. Both
+// inputs are released once they are spilled, an input that is already split
+// into `num_partitions` partitions on the join key keeps its partitions. The
+// result is partitioned the same way and its partitioning is stored in
+// `partitioning` if it holds the join key.
+template <typename T>
+static ColumnarTable execute_join_grace(JoinInput& left_input,
+    JoinInput&                                     right_input,
+    size_t                                         left_join_col,
+    size_t                                         right_join_col,
+    const OutputAttrs&                             output_attrs,
+    bool                                           build_left,
+    GatherOrder                                    gather_order,
+    bool                                           fuse_output,
+    size_t                                         num_partitions,
+    std::optional<Partitioning>&                   partitioning) {
+    // Only the join columns and the output columns are spilled.
+    size_t                num_left_columns = left_input.table.columns.size();
+    std::vector<bool>     left_needed(num_left_columns, false);
+    std::vector<bool>     right_needed(right_input.table.columns.size(), false);
+    std::vector<DataType> left_types, right_types;
+    left_needed[left_join_col]   = true;
+    right_needed[right_join_col] = true;
+    for (auto [attr_idx, _]: output_attrs) {
+        if (attr_idx < num_left_columns) {
+            left_needed[attr_idx] = true;
+        } else {
+            right_needed[attr_idx - num_left_columns] = true;
+        }
+    }
+    for (const auto& column: left_input.table.columns) {
+        left_types.push_back(column.type);
+    }
+    for (const auto& column: right_input.table.columns) {
+        right_types.push_back(column.type);
+    }
+
+    auto spill = [&](JoinInput& input, size_t join_col, const std::vector<bool>& needed) {
+        auto files = input_partitions(input, join_col) == num_partitions
+                       ? spill_partitioned(input.table, *input.partitioning, needed)
+                       : spill_partitions<T>(input.table,
+                             join_col,
+                             input_key_hashes(input, join_col),
+                             needed,
+                             num_partitions);
+        input.release();
+        return files;
+    };
+    auto left_files  = spill(left_input, left_join_col, left_needed);
+    auto right_files = spill(right_input, right_join_col, right_needed);
+
+    ColumnarTable result;
+    Partitioning  result_partitioning;
+    result.columns.reserve(output_attrs.size());
+    for (size_t column_idx = 0; column_idx < output_attrs.size(); ++column_idx) {
+        auto [attr_idx, type] = output_attrs[column_idx];
+        result.columns.emplace_back(type);
+        if (attr_idx == left_join_col || attr_idx == num_left_columns + right_join_col) {
+            result_partitioning.key_columns.push_back(column_idx);
+        }
+    }
+    result_partitioning.partition_rows.assign(num_partitions, 0);
+    result_partitioning.partition_pages.assign(num_partitions,
+        std::vector<size_t>(output_attrs.size(), 0));
+    for (size_t i = 0; i < num_partitions; ++i) {
+        if (left_files[i].num_rows == 0 || right_files[i].num_rows == 0) {
+            continue;
+        }
+        ColumnarTable left_part   = read_partition(left_files[i], left_types);
+        ColumnarTable right_part  = read_partition(right_files[i], right_types);
+        auto&         build_part  = build_left ? left_part : right_part;
+        auto&         probe_part  = build_left ? right_part : left_part;
+        ColumnarTable part_result = execute_join_typed<T>(build_part,
+            probe_part,
+            build_left ? left_join_col : right_join_col,
+            nullptr,
+            build_left ? right_join_col : left_join_col,
+            output_attrs,
+            left_part,
+            right_part,
+            build_left,
+            gather_order,
+            fuse_output);
+
+        result.num_rows                      += part_result.num_rows;
+        result_partitioning.partition_rows[i] = part_result.num_rows;
+        for (size_t column_idx = 0; column_idx < result.columns.size(); ++column_idx) {
+            auto& pages      = result.columns[column_idx].pages;
+            auto& part_pages = part_result.columns[column_idx].pages;
+            result_partitioning.partition_pages[i][column_idx] = part_pages.size();
+            pages.insert(pages.end(), part_pages.begin(), part_pages.end());
+            part_pages.clear();
+        }
+    }
+    if (!result_partitioning.key_columns.empty()) {
+        partitioning = std::move(result_partitioning);
+    }
+    return result;
+}
+
+// --- Push-based pipelines ---
+//
+// A join whose probe side is another join does not materialize the output of
+// that join: the chain of joins down to the scan at its bottom runs as a single
+// pipeline. Worker threads take morsels of `batch_rows` rows of the scan in
+// turn, decode them into a batch and push the batch through the probes of all
+// joins of the chain, from the bottom up. Every probe passes on batches of at
+// most `batch_rows` output rows, so the rows in flight stay in cache. Only the
+// builds break the pipeline: all build sides are executed before it starts and
+// the output of the top join is the only one written to pages.
+
+// Batch holds the decoded rows passed from one pipeline stage to the next. Once
+// a stage hashed its join keys, the hashes travel with the batch along every
+// output column holding the key, so joins further up on the same key do not
+// hash it again.
+struct Batch {
+    size_t                             num_rows = 0;
+    std::vector<DecodedColumn>         columns;
+    // Key hashes of every column, empty for columns no join hashed yet.
+    std::vector<std::vector<uint64_t>> hashes;
+};
+
+// Returns the hashes of the keys in column `key_col` of `batch`, taken from the
+// batch if it carries them and computed into `hashes` otherwise. Null keys get
+// an arbitrary hash.
+template <typename T>
+static const uint64_t*
+batch_key_hashes(const Batch& batch, size_t key_col, std::vector<uint64_t>& hashes) {
+    if (!batch.hashes[key_col].empty()) {
+        return batch.hashes[key_col].data();
+    }
+    const auto& keys = std::get<std::vector<std::optional<T>>>(batch.columns[key_col]);
+    hashes.resize(batch.num_rows);
+    for (size_t row = 0; row < batch.num_rows; ++row) {
+        hashes[row] = keys[row].has_value() ? hash_join_key(keys[row].value()) : 0;
+    }
+    return hashes.data();
+}
+
+// Calls `on_match` with the build rows of `table` matching `key`, the key of
+// probe row `row`. Tables that hash their keys take the hash from `hashes`.
+template <bool UniqueKeys, typename HashTable, typename T, typename F>
+static inline void probe_key(const HashTable& table,
+    const T&                                  key,
+    const uint64_t*                           hashes,
+    size_t                                    row,
+    F&&                                       on_match) {
+    if constexpr (UniqueKeys) {
+        decltype(table.find(key)) build_row;
+        if constexpr (HashTable::HashesKeys) {
+            build_row = table.find(key, hashes[row]);
+        } else {
+            build_row = table.find(key);
+        }
+        if (build_row != HashTable::NoMatch) {
+            on_match(build_row);
+        }
+    } else if constexpr (HashTable::HashesKeys) {
+        table.probe(key, hashes[row], on_match);
+    } else {
+        table.probe(key, on_match);
+    }
+}
+
+// Gathers the hashes of the probe rows `rows` into `dest`, which is left empty
+// if `hashes` is null.
+static void gather_hashes(const uint64_t* hashes,
+    const std::vector<uint32_t>&          rows,
+    std::vector<uint64_t>&                dest) {
+    dest.clear();
+    if (hashes != nullptr) {
+        dest.resize(rows.size());
+        for (size_t i = 0; i < rows.size(); ++i) {
+            dest[i] = hashes[rows[i]];
+        }
+    }
+}
+
+// PipelineStage consumes the batches of the stage below it. Each worker thread
+// pushes its batches with its own thread id.
+struct PipelineStage {
+    virtual ~PipelineStage() = default;
+
+    virtual void push(const Batch& batch, size_t thread_id) = 0;
+
+    // Set once the stage probed with key hashes carried by a batch instead of
+    // hashing the keys itself.
+    std::atomic<bool> reused_key_hashes{false};
+
+    // Records that `carried` hashes are probed with if there are any.
+    void note_reused_key_hashes(const std::vector<uint64_t>& carried) {
+        if (!carried.empty() && !reused_key_hashes.load(std::memory_order_relaxed)) {
+            reused_key_hashes.store(true, std::memory_order_relaxed);
+        }
+    }
+};
+
+// Returns the first row of every page of `column`. The continuation pages of a
+// long string start at the row after it.
+static std::vector<size_t> page_start_rows(const Column& column) {
+    std::vector<size_t> starts;
+    starts.reserve(column.pages.size());
+    size_t row_idx = 0;
+    for (auto* page: column.pages) {
+        auto num_rows = *reinterpret_cast<uint16_t*>(page->data);
+        starts.push_back(row_idx);
+        if (num_rows == 0xffff) {
+            row_idx += 1;
+        } else if (num_rows != 0xfffe) {
+            row_idx += num_rows;
+        }
+    }
+    return starts;
+}
+
+// Decodes rows [begin, end) of `column` into `values`, `starts` holds the first
+// row of each of its pages.
+template <typename T>
+static void decode_rows(const Column& column,
+    const std::vector<size_t>&        starts,
+    size_t                            begin,
+    size_t                            end,
+    std::vector<std::optional<T>>&    values) {
+    values.resize(end - begin);
+    auto   first_page = std::upper_bound(starts.begin(), starts.end(), begin) - 1;
+    size_t page_idx   = first_page - starts.begin();
+    size_t row_idx    = *first_page;
+    for (; page_idx < column.pages.size(); ++page_idx) {
+        auto* page     = column.pages[page_idx]->data;
+        auto  num_rows = *reinterpret_cast<uint16_t*>(page);
+        if constexpr (std::is_same_v<T, std::string>) {
+            auto  num_chars  = *reinterpret_cast<uint16_t*>(page + 2);
+            auto* data_begin = reinterpret_cast<char*>(page + 4);
+            // The continuation of a long string is appended even past `end`.
+            if (num_rows == 0xfffe) {
+                if (row_idx > begin && row_idx <= end) {
+                    values[row_idx - 1 - begin]->append(data_begin, num_chars);
+                }
+                continue;
+            }
+            if (row_idx >= end) {
+                break;
+            }
+            if (num_rows == 0xffff) {
+                if (row_idx >= begin) {
+                    values[row_idx - begin].emplace(data_begin, num_chars);
+                }
+                ++row_idx;
+                continue;
+            }
+        } else if (row_idx >= end) {
+            break;
+        }
+
+        auto*    bitmap   = reinterpret_cast<uint8_t*>(page + PAGE_SIZE - (num_rows + 7) / 8);
+        uint16_t data_idx = 0;
+        for (uint16_t i = 0; i < num_rows && row_idx < end; ++i, ++row_idx) {
+            bool valid = get_bitmap(bitmap, i);
+            if (row_idx < begin) {
+                data_idx += valid;
+            } else if (!valid) {
+                values[row_idx - begin].reset();
+            } else if constexpr (std::is_same_v<T, std::string>) {
+                auto  num_non_null = *reinterpret_cast<uint16_t*>(page + 2);
+                auto* offsets      = reinterpret_cast<uint16_t*>(page + 4);
+                auto* data_begin   = reinterpret_cast<char*>(page + 4 + num_non_null * 2);
+                auto  offset       = data_idx == 0 ? 0 : offsets[data_idx - 1];
+                values[row_idx - begin].emplace(data_begin + offset,
+                    data_begin + offsets[data_idx]);
+                ++data_idx;
+            } else {
+                auto* data = reinterpret_cast<T*>(page + get_fixed_data_offset<T>());
+                values[row_idx - begin] = data[data_idx++];
+            }
+        }
+    }
+}
+
+// PipelineSource decodes morsels of the input at the bottom of a pipeline, only
+// the columns used by the first probe are decoded. Key hashes carried by the
+// input travel with the batches.
+struct PipelineSource {
+    const ColumnarTable&                      table;
+    const std::vector<std::vector<uint64_t>>& hashes;
+    std::vector<bool>                         needed;
+    std::vector<std::vector<size_t>>          page_starts;
+
+    PipelineSource(const ColumnarTable&           table,
+        const std::vector<std::vector<uint64_t>>& hashes,
+        std::vector<bool>                         needed)
+    : table(table)
+    , hashes(hashes)
+    , needed(std::move(needed))
+    , page_starts(table.columns.size()) {
+        for (size_t i = 0; i < table.columns.size(); ++i) {
+            if (this->needed[i]) {
+                page_starts[i] = page_start_rows(table.columns[i]);
+            }
+        }
+    }
+
+    // Decodes rows [begin, end) into `batch`.
+    void read(size_t begin, size_t end, Batch& batch) const {
+        batch.num_rows = end - begin;
+        batch.columns.resize(table.columns.size());
+        batch.hashes.resize(table.columns.size());
+        for (size_t i = 0; i < table.columns.size(); ++i) {
+            if (!needed[i]) {
+                continue;
+            }
+            DISPATCH_DATA_TYPE(table.columns[i].type, T, {
+                using Values = std::vector<std::optional<T>>;
+                if (!std::holds_alternative<Values>(batch.columns[i])) {
+                    batch.columns[i] = Values{};
+                }
+                decode_rows(table.columns[i],
+                    page_starts[i],
+                    begin,
+                    end,
+                    std::get<Values>(batch.columns[i]));
+            });
+            if (i < hashes.size() && !hashes[i].empty()) {
+                batch.hashes[i].assign(hashes[i].begin() + begin, hashes[i].begin() + end);
+            }
+        }
+    }
+};
+
+// Copies the values at `rows` of `source` into `dest`, which takes the type of
+// `source`.
+template <typename Index>
+static void gather_decoded(const DecodedColumn& source,
+    const std::vector<Index>&                   rows,
+    DecodedColumn&                              dest) {
+    std::visit(
+        [&](const auto& values) {
+            using Values = std::decay_t<decltype(values)>;
+            if (!std::holds_alternative<Values>(dest)) {
+                dest = Values{};
+            }
+            auto& gathered = std::get<Values>(dest);
+            gathered.resize(rows.size());
+            for (size_t i = 0; i < rows.size(); ++i) {
+                gathered[i] = values[rows[i]];
+            }
+        },
+        source);
+}
+
+// JoinStage probes the hash table of a join with the batches of the stage below
+// and pushes batches of its output to the next stage.
+template <typename T, typename RowId>
+struct JoinStage: PipelineStage {
+    // Matches of a worker thread that are not yet pushed to the next stage.
+    struct ThreadState {
+        std::vector<uint32_t> probe_rows;
+        std::vector<RowId>    build_rows;
+        // Key hashes of the batch being probed, null if not computed.
+        const uint64_t*       hashes = nullptr;
+        std::vector<uint64_t> computed_hashes;
+        Batch                 output;
+    };
+
+    JoinBuild<T, RowId>        build;
+    // Decoded build side columns, only those in the output are decoded.
+    std::vector<DecodedColumn> build_columns;
+    size_t                     probe_join_col;
+    std::vector<bool>          from_build;
+    std::vector<size_t>        source_columns;
+    // Output columns holding the join key.
+    std::vector<bool>          key_columns;
+    PipelineStage&             next;
+    size_t                     batch_rows;
+    std::vector<ThreadState>   states;
+
+    JoinStage(const ColumnarTable& build_table,
+        size_t                     build_join_col,
+        const uint64_t*            build_hashes,
+        size_t                     probe_join_col,
+        const OutputAttrs&         output_attrs,
+        size_t                     num_left_columns,
+        bool                       build_left,
+        PipelineStage&             next,
+        size_t                     batch_rows,
+        size_t                     num_threads)
+    : build(build_table, build_join_col, build_hashes)
+    , build_columns(build_table.columns.size())
+    , probe_join_col(probe_join_col)
+    , next(next)
+    , batch_rows(batch_rows)
+    , states(num_threads) {
+        for (auto [attr_idx, type]: output_attrs) {
+            bool   from_left = attr_idx < num_left_columns;
+            size_t column    = from_left ? attr_idx : attr_idx - num_left_columns;
+            from_build.push_back(from_left == build_left);
+            source_columns.push_back(column);
+            if (from_build.back()) {
+                DISPATCH_DATA_TYPE(type, V, {
+                    build_columns[column] = extract_values_for_column<V>(build_table, column);
+                });
+            }
+            size_t join_col = from_build.back() ? build_join_col : probe_join_col;
+            key_columns.push_back(column == join_col);
+        }
+        for (auto& state: states) {
+            state.output.columns.resize(output_attrs.size());
+            state.output.hashes.resize(output_attrs.size());
+        }
+    }
+
+    void push(const Batch& batch, size_t thread_id) override {
+        using Keys = std::vector<std::optional<T>>;
+
+        auto&       state = states[thread_id];
+        const auto& keys  = std::get<Keys>(batch.columns[probe_join_col]);
+        auto        emit  = [&](uint32_t probe_row, size_t build_row) {
+            state.probe_rows.push_back(probe_row);
+            state.build_rows.push_back(static_cast<RowId>(build_row));
+            if (state.probe_rows.size() >= batch_rows) {
+                flush(batch, state, thread_id);
+            }
+        };
+        const auto& carried = batch.hashes[probe_join_col];
+        state.hashes        = carried.empty() ? nullptr : carried.data();
+        if (build.hashes_keys()) {
+            state.hashes = batch_key_hashes<T>(batch, probe_join_col, state.computed_hashes);
+            note_reused_key_hashes(carried);
+        }
+        build.visit([&](auto unique_keys, const auto& table) {
+            for (uint32_t row = 0; row < batch.num_rows; ++row) {
+                if (!keys[row].has_value()) {
+                    continue;
+                }
+                const T& key = keys[row].value();
+                if (!build.heavy_hitters.empty()) {
+                    int64_t slot = build.heavy_hitters.find(key);
+                    if (slot >= 0) {
+                        for (size_t build_row: build.heavy_hitters.rows[slot]) {
+                            emit(row, build_row);
+                        }
+                        continue;
+                    }
+                }
+                probe_key<decltype(unique_keys)::value>(table,
+                    key,
+                    state.hashes,
+                    row,
+                    [&](RowId build_row) { emit(row, build_row); });
+            }
+        });
+        flush(batch, state, thread_id);
+    }
+
+    // Gathers the output of the buffered matches and pushes it to the next
+    // stage.
+    void flush(const Batch& batch, ThreadState& state, size_t thread_id) {
+        if (state.probe_rows.empty()) {
+            return;
+        }
+        auto& output    = state.output;
+        output.num_rows = state.probe_rows.size();
+        for (size_t i = 0; i < from_build.size(); ++i) {
+            if (from_build[i]) {
+                gather_decoded(build_columns[source_columns[i]],
+                    state.build_rows,
+                    output.columns[i]);
+            } else {
+                gather_decoded(batch.columns[source_columns[i]],
+                    state.probe_rows,
+                    output.columns[i]);
+            }
+            // Build keys equal the probe keys and share their hashes.
+            const uint64_t* hashes = nullptr;
+            if (key_columns[i]) {
+                hashes = state.hashes;
+            } else if (!from_build[i] && !batch.hashes[source_columns[i]].empty()) {
+                hashes = batch.hashes[source_columns[i]].data();
+            }
+            gather_hashes(hashes, state.probe_rows, output.hashes[i]);
+        }
+        state.probe_rows.clear();
+        state.build_rows.clear();
+        next.push(output, thread_id);
+    }
+};
+
+// BatchColumnWriter appends one column of every batch to pages.
+struct BatchColumnWriter {
+    virtual ~BatchColumnWriter() = default;
+
+    virtual void append(const DecodedColumn& values, size_t num_rows) = 0;
+    virtual void finalize()                                           = 0;
+};
+
+template <typename T>
+struct TypedBatchColumnWriter: BatchColumnWriter {
+    ColumnInserter<T> inserter;
+
+    TypedBatchColumnWriter(Column& column, bool streaming)
+    : inserter(column, streaming) {}
+
+    void append(const DecodedColumn& values, size_t num_rows) override {
+        const auto& typed = std::get<std::vector<std::optional<T>>>(values);
+        for (size_t i = 0; i < num_rows; ++i) {
+            if (typed[i].has_value()) {
+                inserter.insert(typed[i].value());
+            } else {
+                inserter.insert_null();
+            }
+        }
+    }
+
+    void finalize() override { inserter.finalize(); }
+};
+
+// PipelineSink writes the output of the top join of a pipeline to one run of
+// pages per worker thread, the runs are concatenated in thread order at the end.
+// If `keep_hashes` is set, the key hashes of the batches are kept as well for
+// the joins that use the output.
+struct PipelineSink: PipelineStage {
+    struct Run {
+        std::vector<Column>                             columns;
+        std::vector<std::unique_ptr<BatchColumnWriter>> writers;
+        std::vector<std::vector<uint64_t>>              hashes;
+        size_t                                          num_rows = 0;
+    };
+
+    std::vector<DataType>              types;
+    std::vector<Run>                   runs;
+    bool                               keep_hashes;
+    // Key hashes of the result columns, set by finish. Columns that some batch
+    // did not carry hashes for have none.
+    std::vector<std::vector<uint64_t>> hashes;
+
+    PipelineSink(const OutputAttrs& output_attrs,
+        size_t                      num_threads,
+        bool                        streaming,
+        bool                        keep_hashes)
+    : runs(num_threads)
+    , keep_hashes(keep_hashes) {
+        for (auto [_, type]: output_attrs) {
+            types.push_back(type);
+        }
+        // The writers keep references to their column, so the columns are
+        // never reallocated once the writers exist.
+        for (auto& run: runs) {
+            run.hashes.resize(types.size());
+            run.columns.reserve(types.size());
+            for (auto type: types) {
+                run.columns.emplace_back(type);
+                DISPATCH_DATA_TYPE(type, T, {
+                    run.writers.emplace_back(std::make_unique<TypedBatchColumnWriter<T>>(
+                        run.columns.back(),
+                        streaming));
+                });
+            }
+        }
+    }
+
+    void push(const Batch& batch, size_t thread_id) override {
+        auto& run = runs[thread_id];
+        for (size_t i = 0; i < run.writers.size(); ++i) {
+            run.writers[i]->append(batch.columns[i], batch.num_rows);
+            if (keep_hashes) {
+                const auto& batch_hashes = batch.hashes[i];
+                run.hashes[i].insert(run.hashes[i].end(),
+                    batch_hashes.begin(),
+                    batch_hashes.end());
+            }
+        }
+        run.num_rows += batch.num_rows;
+    }
+
+    // Writes the last page of the run of `thread_id`. Called by the worker
+    // thread itself, so that its streaming stores are fenced before the run
+    // is handed over.
+    void finalize(size_t thread_id) {
+        for (auto& writer: runs[thread_id].writers) {
+            writer->finalize();
+        }
+    }
+
+    // Concatenates the finalized runs of all threads into the pipeline result.
+    ColumnarTable finish() {
+        ColumnarTable result;
+        result.columns.reserve(types.size());
+        for (auto type: types) {
+            result.columns.emplace_back(type);
+        }
+        hashes.resize(types.size());
+        for (auto& run: runs) {
+            result.num_rows += run.num_rows;
+            for (size_t i = 0; i < run.columns.size(); ++i) {
+                auto& pages     = result.columns[i].pages;
+                auto& run_pages = run.columns[i].pages;
+                pages.insert(pages.end(), run_pages.begin(), run_pages.end());
+                run_pages.clear();
+                hashes[i].insert(hashes[i].end(), run.hashes[i].begin(), run.hashes[i].end());
+            }
+        }
+        runs.clear();
+        for (auto& column_hashes: hashes) {
+            if (column_hashes.size() != result.num_rows) {
+                column_hashes.clear();
+            }
+        }
+        return result;
+    }
+};
+
+// Creates the stage of `join` probing the hash table of `build_table`, whose
+// key hashes are in `build_hashes` if they are known.
+static std::unique_ptr<PipelineStage> make_join_stage(const Plan& plan,
+    const JoinNode&                                               join,
+    const OutputAttrs&                                            output_attrs,
+    const ColumnarTable&                                          build_table,
+    const uint64_t*                                               build_hashes,
+    PipelineStage&                                                next,
+    size_t                                                        batch_rows,
+    size_t                                                        num_threads) {
+    auto build_idx        = join.build_left ? join.left : join.right;
+    auto build_join_col   = join.build_left ? join.left_attr : join.right_attr;
+    auto probe_join_col   = join.build_left ? join.right_attr : join.left_attr;
+    auto num_left_columns = plan.nodes[join.left].output_attrs.size();
+
+    auto make_stage = [&](auto type_tag) -> std::unique_ptr<PipelineStage> {
+        using T = decltype(type_tag);
+        if (build_table.num_rows <= std::numeric_limits<uint32_t>::max()) {
+            return std::make_unique<JoinStage<T, uint32_t>>(build_table,
+                build_join_col,
+                build_hashes,
+                probe_join_col,
+                output_attrs,
+                num_left_columns,
+                join.build_left,
+                next,
+                batch_rows,
+                num_threads);
+        }
+        return std::make_unique<JoinStage<T, uint64_t>>(build_table,
+            build_join_col,
+            build_hashes,
+            probe_join_col,
+            output_attrs,
+            num_left_columns,
+            join.build_left,
+            next,
+            batch_rows,
+            num_threads);
+    };
+
+    switch (std::get<1>(plan.nodes[build_idx].output_attrs[build_join_col])) {
+    case DataType::INT32: {
+        return make_stage(int32_t{});
+    }
+    case DataType::INT64: {
+        return make_stage(int64_t{});
+    }
+    case DataType::FP64: {
+        return make_stage(double{});
+    }
+    case DataType::VARCHAR:
+    default:
+        throw std::runtime_error(
+            fmt::format("Unsupported data type for join column: {}", DataType::VARCHAR));
+    }
+}
+
+// --- Star joins ---
+//
+// Consecutive joins of a pipeline whose probe keys all belong to the equivalence
+// class of the probe key of the lowest one, such as `t.id = mi.movie_id =
+// mk.movie_id`, run as a single n-ary join. Every driving row looks its key up
+// in the hash tables of all joins first and produces output only if all of them
+// match, so rows that a later join drops are never gathered.
+
+// Joins of a pipeline with their output attributes, from the top down.
+using PipelineJoins = std::vector<std::tuple<const JoinNode*, const OutputAttrs*>>;
+
+// StarJoinGroup is a run of consecutive joins of a pipeline on one equivalence
+// class. Its columns are traced back to a column of the group input, member -1,
+// or to a column of the build side of a member.
+struct StarJoinGroup {
+    // Indices of the member joins in the pipeline joins, from the bottom up.
+    std::vector<size_t>                 members;
+    std::vector<std::pair<int, size_t>> columns;
+    size_t                              input_key_col = 0;
+};
+
+// Splits the joins of a pipeline into star join groups, from the bottom up.
+static std::vector<StarJoinGroup>
+star_join_groups(const Plan& plan, const PipelineJoins& joins) {
+    std::vector<StarJoinGroup> groups;
+    // Columns holding the key of the current group.
+    std::vector<std::pair<int, size_t>> keys;
+    for (size_t i = joins.size(); i-- > 0;) {
+        const auto& join              = *std::get<0>(joins[i]);
+        auto        probe_idx         = join.build_left ? join.right : join.left;
+        auto        build_join_col    = join.build_left ? join.left_attr : join.right_attr;
+        auto        probe_join_col    = join.build_left ? join.right_attr : join.left_attr;
+        auto        num_left_columns  = plan.nodes[join.left].output_attrs.size();
+        auto        num_probe_columns = plan.nodes[probe_idx].output_attrs.size();
+
+        if (groups.empty()
+            || std::find(keys.begin(), keys.end(), groups.back().columns[probe_join_col])
+                   == keys.end()) {
+            auto& group         = groups.emplace_back();
+            group.input_key_col = probe_join_col;
+            for (size_t column = 0; column < num_probe_columns; ++column) {
+                group.columns.emplace_back(-1, column);
+            }
+            keys = {{-1, probe_join_col}};
+        }
+
+        auto& group  = groups.back();
+        int   member = static_cast<int>(group.members.size());
+        group.members.push_back(i);
+        keys.emplace_back(member, build_join_col);
+        std::vector<std::pair<int, size_t>> columns;
+        for (auto [attr_idx, _]: *std::get<1>(joins[i])) {
+            bool   from_left = attr_idx < num_left_columns;
+            size_t column    = from_left ? attr_idx : attr_idx - num_left_columns;
+            if (from_left == join.build_left) {
+                columns.emplace_back(member, column);
+            } else {
+                columns.push_back(group.columns[column]);
+            }
+        }
+        group.columns = std::move(columns);
+    }
+    return groups;
+}
+
+// StarJoinStage probes the hash tables of all members of a star join group with
+// the batches of the stage below and pushes batches of the output of the top
+// member to the next stage.
+template <typename T, typename RowId>
+struct StarJoinStage: PipelineStage {
+    // Matches of a worker thread that are not yet pushed to the next stage.
+    struct ThreadState {
+        // Build rows of each member matching the current probe row.
+        std::vector<std::vector<RowId>> row_matches;
+        std::vector<size_t>             positions;
+        std::vector<uint32_t>           probe_rows;
+        std::vector<std::vector<RowId>> build_rows;
+        // Key hashes of the batch being probed, null if not computed.
+        const uint64_t*                 hashes = nullptr;
+        std::vector<uint64_t>           computed_hashes;
+        Batch                           output;
+    };
+
+    std::vector<JoinBuild<T, RowId>>        builds;
+    // Decoded build side columns of each member, only those in the output are
+    // decoded.
+    std::vector<std::vector<DecodedColumn>> build_columns;
+    size_t                                  probe_join_col;
+    std::vector<std::pair<int, size_t>>     columns;
+    // Output columns holding the join key.
+    std::vector<bool>                       key_columns;
+    bool                                    hashes_keys = false;
+    PipelineStage&                          next;
+    size_t                                  batch_rows;
+    std::vector<ThreadState>                states;
+
+    StarJoinStage(const std::vector<const ColumnarTable*>& build_tables,
+        const std::vector<size_t>&                         build_join_cols,
+        const std::vector<const uint64_t*>&                build_hashes,
+        const StarJoinGroup&                               group,
+        const OutputAttrs&                                 output_attrs,
+        PipelineStage&                                     next,
+        size_t                                             batch_rows,
+        size_t                                             num_threads)
+    : build_columns(build_tables.size())
+    , probe_join_col(group.input_key_col)
+    , columns(group.columns)
+    , next(next)
+    , batch_rows(batch_rows)
+    , states(num_threads) {
+        builds.reserve(build_tables.size());
+        for (size_t member = 0; member < build_tables.size(); ++member) {
+            builds.emplace_back(*build_tables[member],
+                build_join_cols[member],
+                build_hashes[member]);
+            build_columns[member].resize(build_tables[member]->columns.size());
+            hashes_keys = hashes_keys || builds.back().hashes_keys();
+        }
+        for (size_t i = 0; i < columns.size(); ++i) {
+            auto [member, column] = columns[i];
+            if (member >= 0) {
+                DISPATCH_DATA_TYPE(std::get<1>(output_attrs[i]), V, {
+                    build_columns[member][column] =
+                        extract_values_for_column<V>(*build_tables[member], column);
+                });
+            }
+            size_t join_col = member >= 0 ? build_join_cols[member] : probe_join_col;
+            key_columns.push_back(column == join_col);
+        }
+        for (auto& state: states) {
+            state.row_matches.resize(builds.size());
+            state.build_rows.resize(builds.size());
+            state.output.columns.resize(columns.size());
+            state.output.hashes.resize(columns.size());
+        }
+    }
+
+    // Collects the build rows of `build` whose key equals `key`, the key of
+    // probe row `row`, into `rows`.
+    static void lookup(const JoinBuild<T, RowId>& build,
+        const T&                                  key,
+        const uint64_t*                           hashes,
+        uint32_t                                  row,
+        std::vector<RowId>&                       rows) {
+        rows.clear();
+        if (!build.heavy_hitters.empty()) {
+            int64_t slot = build.heavy_hitters.find(key);
+            if (slot >= 0) {
+                for (size_t build_row: build.heavy_hitters.rows[slot]) {
+                    rows.push_back(static_cast<RowId>(build_row));
+                }
+                return;
+            }
+        }
+        build.visit([&](auto unique_keys, const auto& table) {
+            probe_key<decltype(unique_keys)::value>(table,
+                key,
+                hashes,
+                row,
+                [&](RowId build_row) { rows.push_back(build_row); });
+        });
+    }
+
+    void push(const Batch& batch, size_t thread_id) override {
+        using Keys = std::vector<std::optional<T>>;
+
+        auto&       state       = states[thread_id];
+        const auto& keys        = std::get<Keys>(batch.columns[probe_join_col]);
+        size_t      num_members = builds.size();
+        // Every key is hashed at most once for all members.
+        const auto& carried = batch.hashes[probe_join_col];
+        state.hashes        = carried.empty() ? nullptr : carried.data();
+        if (hashes_keys) {
+            state.hashes = batch_key_hashes<T>(batch, probe_join_col, state.computed_hashes);
+            note_reused_key_hashes(carried);
+        }
+        for (uint32_t row = 0; row < batch.num_rows; ++row) {
+            if (!keys[row].has_value()) {
+                continue;
+            }
+            // Every member has to match before any output is produced.
+            bool matched = true;
+            for (size_t member = 0; member < num_members && matched; ++member) {
+                lookup(builds[member],
+                    keys[row].value(),
+                    state.hashes,
+                    row,
+                    state.row_matches[member]);
+                matched = !state.row_matches[member].empty();
+            }
+            if (!matched) {
+                continue;
+            }
+
+            // Emit the cross product of the matches of all members.
+            state.positions.assign(num_members, 0);
+            while (true) {
+                state.probe_rows.push_back(row);
+                for (size_t member = 0; member < num_members; ++member) {
+                    auto build_row = state.row_matches[member][state.positions[member]];
+                    state.build_rows[member].push_back(build_row);
+                }
+                if (state.probe_rows.size() >= batch_rows) {
+                    flush(batch, state, thread_id);
+                }
+                size_t member = 0;
+                while (member < num_members
+                       && ++state.positions[member] == state.row_matches[member].size()) {
+                    state.positions[member++] = 0;
+                }
+                if (member == num_members) {
+                    break;
+                }
+            }
+        }
+        flush(batch, state, thread_id);
+    }
+
+    // Gathers the output of the buffered matches and pushes it to the next
+    // stage.
+    void flush(const Batch& batch, ThreadState& state, size_t thread_id) {
+        if (state.probe_rows.empty()) {
+            return;
+        }
+        auto& output    = state.output;
+        output.num_rows = state.probe_rows.size();
+        for (size_t i = 0; i < columns.size(); ++i) {
+            auto [member, column] = columns[i];
+            if (member >= 0) {
+                gather_decoded(build_columns[member][column],
+                    state.build_rows[member],
+                    output.columns[i]);
+            } else {
+                gather_decoded(batch.columns[column], state.probe_rows, output.columns[i]);
+            }
+            const uint64_t* hashes = nullptr;
+            if (key_columns[i]) {
+                hashes = state.hashes;
+            } else if (member < 0 && !batch.hashes[column].empty()) {
+                hashes = batch.hashes[column].data();
+            }
+            gather_hashes(hashes, state.probe_rows, output.hashes[i]);
+        }
+        state.probe_rows.clear();
+        for (auto& rows: state.build_rows) {
+            rows.clear();
+        }
+        next.push(output, thread_id);
+    }
+};
+
+// Creates the stage of a star join group of at least two joins, `builds` holds
+// the build side of every join of the pipeline.
+static std::unique_ptr<PipelineStage> make_star_join_stage(const Plan& plan,
+    const PipelineJoins&                                               joins,
+    const StarJoinGroup&                                               group,
+    const std::vector<JoinInput>&                                      builds,
+    PipelineStage&                                                     next,
+    size_t                                                             batch_rows,
+    size_t                                                             num_threads) {
+    std::vector<const ColumnarTable*> build_tables;
+    std::vector<size_t>               build_join_cols;
+    std::vector<const uint64_t*>      build_hashes;
+    size_t                            max_build_rows = 0;
+    for (auto join_idx: group.members) {
+        const auto& join = *std::get<0>(joins[join_idx]);
+        build_tables.push_back(&builds[join_idx].table);
+        build_join_cols.push_back(join.build_left ? join.left_attr : join.right_attr);
+        build_hashes.push_back(input_key_hashes(builds[join_idx], build_join_cols.back()));
+        max_build_rows = std::max(max_build_rows, builds[join_idx].table.num_rows);
+    }
+    const auto& output_attrs = *std::get<1>(joins[group.members.back()]);
+
+    auto make_stage = [&](auto type_tag) -> std::unique_ptr<PipelineStage> {
+        using T = decltype(type_tag);
+        if (max_build_rows <= std::numeric_limits<uint32_t>::max()) {
+            return std::make_unique<StarJoinStage<T, uint32_t>>(build_tables,
+                build_join_cols,
+                build_hashes,
+                group,
+                output_attrs,
+                next,
+                batch_rows,
+                num_threads);
+        }
+        return std::make_unique<StarJoinStage<T, uint64_t>>(build_tables,
+            build_join_cols,
+            build_hashes,
+            group,
+            output_attrs,
+            next,
+            batch_rows,
+            num_threads);
+    };
+
+    const auto& bottom    = *std::get<0>(joins[group.members.front()]);
+    auto        build_idx = bottom.build_left ? bottom.left : bottom.right;
+    switch (std::get<1>(plan.nodes[build_idx].output_attrs[build_join_cols.front()])) {
+    case DataType::INT32: {
+        return make_stage(int32_t{});
+    }
+    case DataType::INT64: {
+        return make_stage(int64_t{});
+    }
+    case DataType::FP64: {
+        return make_stage(double{});
+    }
+    case DataType::VARCHAR:
+    default:
+        throw std::runtime_error(
+            fmt::format("Unsupported data type for join column: {}", DataType::VARCHAR));
+    }
+}
 
-    // Recursively execute child nodes
-    auto left_result  = execute_impl(plan, left);
-    auto right_result = execute_impl(plan, right);
+// Joins the executed inputs of `join`.
+static ColumnarTable execute_join_inputs(ColumnarExecutor& executor,
+    const Plan&                                            plan,
+    const JoinNode&                                        join,
+    const OutputAttrs&                                     output_attrs,
+    JoinInput&                                             left_input,
+    JoinInput&                                             right_input) {
+    auto        left         = join.left;
+    auto        right        = join.right;
+    auto        gather_order = executor.gather_order;
+    const auto& left_result  = left_input.table;
+    const auto& right_result = right_input.table;
 
     auto left_join_col  = join.left_attr;
     auto right_join_col = join.right_attr;
@@ -738,63 +2917,88 @@ ColumnarTable ColumnarExecutor::execute_join(const Plan& plan,
         join_col_type = std::get<1>(plan.nodes[right].output_attrs[build_join_col]);
     }
 
-    std::vector<std::mutex>                partition_mutexes(NumPartitions);
-    std::vector<std::pair<size_t, size_t>> matches;
+    // The root join and narrow joins write their output while probing, the
+    // explicit gather orders always go through the match list.
+    bool is_root     = &join == std::get_if<JoinNode>(&plan.nodes[plan.root].data);
+    bool fuse_output = gather_order == GatherOrder::Auto
+                    && (is_root || output_attrs.size() <= FusedMaxOutputColumns);
+
+    // Joins whose hash table, matches and output would exceed the memory budget
+    // spill both inputs to disk and are joined one partition at a time.
+    size_t join_bytes     = join_memory_bytes(build_table.num_rows,
+        probe_table.num_rows,
+        output_attrs);
+    size_t memory_budget  = executor.memory_budget;
+    bool   spill          = build_table.num_rows > SmallBuildMaxRows
+                       && executor.memory_in_use + join_bytes > memory_budget;
+    size_t num_partitions = 0;
+    if (spill) {
+        size_t input_bytes = left_input.charged_bytes + right_input.charged_bytes;
+        size_t other_bytes = executor.memory_in_use - input_bytes;
+        size_t available   = memory_budget > other_bytes ? memory_budget - other_bytes : 0;
+        num_partitions     = grace_partitions(input_bytes + join_bytes, available);
+        // An input partitioned on an equivalent key by a grace hash join below
+        // keeps its partitions if there are at least as many as needed.
+        for (size_t reused: {input_partitions(left_input, left_join_col),
+                 input_partitions(right_input, right_join_col)}) {
+            if (reused >= num_partitions) {
+                num_partitions = reused;
+            }
+        }
+        // The other inputs are partitioned by their carried key hashes if they
+        // have them.
+        for (auto [input, join_col]: {std::pair{&left_input, left_join_col},
+                 std::pair{&right_input, right_join_col}}) {
+            if (input_partitions(*input, join_col) == num_partitions) {
+                ++executor.reused_partitionings;
+            } else if (input_key_hashes(*input, join_col)) {
+                ++executor.reused_key_hashes;
+            }
+        }
+    }
+    // Build sides that get a hash table take the key hashes carried by them.
+    auto& build_input  = join.build_left ? left_input : right_input;
+    auto* build_hashes = input_key_hashes(build_input, build_join_col);
+    if (!spill && build_hashes && build_table.num_rows > SmallBuildMaxRows) {
+        ++executor.reused_key_hashes;
+    }
 
-    switch (join_col_type) {
-    case DataType::INT32: {
-        auto partitioned_hash_table_int32 = PartitionedHashTable<int32_t>(NumPartitions);
-        hash_join_build_partitioned<int32_t>(build_table,
+    auto execute_typed = [&](auto type_tag) {
+        using T = decltype(type_tag);
+        if (spill) {
+            return execute_join_grace<T>(left_input,
+                right_input,
+                left_join_col,
+                right_join_col,
+                output_attrs,
+                join.build_left,
+                gather_order,
+                fuse_output,
+                num_partitions,
+                executor.output_partitioning);
+        }
+        return execute_join_typed<T>(build_table,
+            probe_table,
             build_join_col,
-            std::ref(partitioned_hash_table_int32),
-            partition_mutexes);
-        hash_join_probe_partitioned<int32_t>(probe_table,
+            build_hashes,
             probe_join_col,
-            std::cref(partitioned_hash_table_int32),
-            matches);
-        ColumnarTable result = build_result_columns(matches,
             output_attrs,
             left_result,
             right_result,
-            build_table.num_rows == left_result.num_rows);
-        // Step 4: Return the result.
-        return result;
+            join.build_left,
+            gather_order,
+            fuse_output);
+    };
+
+    switch (join_col_type) {
+    case DataType::INT32: {
+        return execute_typed(int32_t{});
     }
     case DataType::INT64: {
-        auto partitioned_hash_table_int64 = PartitionedHashTable<int64_t>(NumPartitions);
-        hash_join_build_partitioned<int64_t>(build_table,
-            build_join_col,
-            std::ref(partitioned_hash_table_int64),
-            partition_mutexes);
-        hash_join_probe_partitioned<int64_t>(probe_table,
-            probe_join_col,
-            std::cref(partitioned_hash_table_int64),
-            matches);
-        ColumnarTable result = build_result_columns(matches,
-            output_attrs,
-            left_result,
-            right_result,
-            build_table.num_rows == left_result.num_rows);
-        // Step 4: Return the result.
-        return result;
+        return execute_typed(int64_t{});
     }
     case DataType::FP64: {
-        auto partitioned_hash_table_double = PartitionedHashTable<double>(NumPartitions);
-        hash_join_build_partitioned<double>(build_table,
-            build_join_col,
-            std::ref(partitioned_hash_table_double),
-            partition_mutexes);
-        hash_join_probe_partitioned<double>(probe_table,
-            probe_join_col,
-            std::cref(partitioned_hash_table_double),
-            matches);
-        ColumnarTable result = build_result_columns(matches,
-            output_attrs,
-            left_result,
-            right_result,
-            build_table.num_rows == left_result.num_rows);
-        // Step 4: Return the result.
-        return result;
+        return execute_typed(double{});
     }
     case DataType::VARCHAR:
     default:
@@ -802,3 +3006,172 @@ ColumnarTable ColumnarExecutor::execute_join(const Plan& plan,
             fmt::format("Unsupported data type for join column: {}", DataType::VARCHAR));
     }
 }
+
+// Runs `join` and the joins below it on its probe side as one pipeline and
+// returns the output of `join`. If the hash tables of all joins of the pipeline
+// do not fit in the memory budget together, the joins run one at a time from
+// the bottom up on the build sides already executed.
+static ColumnarTable execute_pipeline(ColumnarExecutor& executor,
+    const Plan&                                         plan,
+    const JoinNode&                                     join,
+    const OutputAttrs&                                  output_attrs) {
+    // Joins of the pipeline from the top down, each one probes the output of
+    // the next one and the last one probes the source scan.
+    PipelineJoins joins{{&join, &output_attrs}};
+    size_t        source_idx;
+    while (true) {
+        const auto* top_join   = std::get<0>(joins.back());
+        size_t      probe_idx  = top_join->build_left ? top_join->right : top_join->left;
+        const auto* probe_join = std::get_if<JoinNode>(&plan.nodes[probe_idx].data);
+        if (probe_join == nullptr) {
+            source_idx = probe_idx;
+            break;
+        }
+        joins.emplace_back(probe_join, &plan.nodes[probe_idx].output_attrs);
+    }
+
+    // The build sides of all joins are held while the pipeline runs.
+    std::vector<JoinInput> builds(joins.size());
+    size_t                 hash_table_bytes = 0;
+    for (size_t i = 0; i < joins.size(); ++i) {
+        const auto* build_join = std::get<0>(joins[i]);
+        execute_join_input(executor,
+            plan,
+            build_join->build_left ? build_join->left : build_join->right,
+            builds[i]);
+        if (builds[i].table.num_rows > SmallBuildMaxRows) {
+            hash_table_bytes += builds[i].table.num_rows * HashTableBytesPerRow;
+        }
+    }
+    JoinInput source;
+    execute_join_input(executor, plan, source_idx, source);
+
+    // The output is not known before the pipeline runs, the source is assumed
+    // to produce one output row per row.
+    size_t pipeline_bytes = hash_table_bytes
+                          + source.table.num_rows * output_row_bytes(output_attrs);
+    if (executor.memory_in_use + pipeline_bytes > executor.memory_budget) {
+        // Each join probes the output of the one below it, starting from the
+        // source.
+        auto& probe = source;
+        for (size_t i = joins.size(); i-- > 0;) {
+            const auto& level       = *std::get<0>(joins[i]);
+            auto&       left_input  = level.build_left ? builds[i] : probe;
+            auto&       right_input = level.build_left ? probe : builds[i];
+            auto        output      = execute_join_inputs(executor,
+                plan,
+                level,
+                *std::get<1>(joins[i]),
+                left_input,
+                right_input);
+            if (i == 0) {
+                return output;
+            }
+            builds[i].release();
+            probe.release();
+            probe.table        = std::move(output);
+            probe.partitioning = std::exchange(executor.output_partitioning, std::nullopt);
+            probe.charge(executor.memory_in_use);
+        }
+    }
+
+    // Build sides that get a hash table take the key hashes carried by them.
+    std::vector<const uint64_t*> build_hashes(joins.size());
+    for (size_t i = 0; i < joins.size(); ++i) {
+        const auto& build_join = *std::get<0>(joins[i]);
+        build_hashes[i]        = input_key_hashes(builds[i],
+            build_join.build_left ? build_join.left_attr : build_join.right_attr);
+        if (build_hashes[i] && builds[i].table.num_rows > SmallBuildMaxRows) {
+            ++executor.reused_key_hashes;
+        }
+    }
+
+    // As for fused output, the size of the source is used to decide whether to
+    // stream the output. The key hashes of the output are kept unless it is
+    // the result of the plan.
+    bool         streaming   = stream_output(source.table.num_rows, output_attrs);
+    size_t       num_threads = std::max(1u, std::thread::hardware_concurrency());
+    bool         is_root     = &join == std::get_if<JoinNode>(&plan.nodes[plan.root].data);
+    PipelineSink sink(output_attrs, num_threads, streaming, !is_root);
+    auto         groups      = star_join_groups(plan, joins);
+    std::vector<std::unique_ptr<PipelineStage>> stages;
+    PipelineStage*                              next = &sink;
+    for (size_t g = groups.size(); g-- > 0;) {
+        size_t join_idx = groups[g].members.front();
+        if (groups[g].members.size() > 1) {
+            stages.push_back(make_star_join_stage(plan,
+                joins,
+                groups[g],
+                builds,
+                *next,
+                executor.batch_rows,
+                num_threads));
+        } else {
+            stages.push_back(make_join_stage(plan,
+                *std::get<0>(joins[join_idx]),
+                *std::get<1>(joins[join_idx]),
+                builds[join_idx].table,
+                build_hashes[join_idx],
+                *next,
+                executor.batch_rows,
+                num_threads));
+        }
+        next = stages.back().get();
+    }
+
+    // The source decodes the columns used by the bottom group.
+    std::vector<bool> needed(source.table.columns.size(), false);
+    needed[groups.front().input_key_col] = true;
+    for (auto [member, column]: groups.front().columns) {
+        if (member < 0) {
+            needed[column] = true;
+        }
+    }
+    PipelineSource pipeline_source(source.table, source.hashes, std::move(needed));
+
+    // Worker threads take morsels of the source in turn until none are left.
+    std::atomic<size_t> next_row{0};
+    size_t              source_rows = source.table.num_rows;
+    auto                worker      = [&](size_t thread_id) {
+        Batch batch;
+        for (size_t begin = next_row.fetch_add(executor.batch_rows); begin < source_rows;
+             begin        = next_row.fetch_add(executor.batch_rows)) {
+            size_t end = std::min(begin + executor.batch_rows, source_rows);
+            pipeline_source.read(begin, end, batch);
+            next->push(batch, thread_id);
+        }
+        sink.finalize(thread_id);
+    };
+    std::vector<std::thread> threads;
+    for (size_t thread_id = 0; thread_id < num_threads; ++thread_id) {
+        threads.emplace_back(worker, thread_id);
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    for (const auto& stage: stages) {
+        executor.reused_key_hashes += stage->reused_key_hashes.load();
+    }
+    auto result            = sink.finish();
+    executor.output_hashes = std::move(sink.hashes);
+    return result;
+}
+
+ColumnarTable ColumnarExecutor::execute_join(const Plan& plan,
+    const JoinNode&                                      join,
+    const OutputAttrs&                                   output_attrs) {
+    // A join probing another join runs as one pipeline with it, the explicit
+    // gather orders materialize the output of every join.
+    auto probe_idx = join.build_left ? join.right : join.left;
+    if (batch_rows != 0 && gather_order == GatherOrder::Auto
+        && std::holds_alternative<JoinNode>(plan.nodes[probe_idx].data)) {
+        return execute_pipeline(*this, plan, join, output_attrs);
+    }
+
+    // Recursively execute child nodes, scans are read in place.
+    JoinInput left_input, right_input;
+    execute_join_input(*this, plan, join.left, left_input);
+    execute_join_input(*this, plan, join.right, right_input);
+    return execute_join_inputs(*this, plan, join, output_attrs, left_input, right_input);
+}
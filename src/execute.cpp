@@ -348,6 +348,7 @@ ColumnarTable execute(const Plan& plan, [[maybe_unused]] void* context) {
     // Table table{std::move(ret), std::move(ret_types)};
     // return table.to_columnar();
     ColumnarExecutor executor;
+    executor.charge_inputs(plan);
     return executor.execute_impl(plan, plan.root);
 }
 
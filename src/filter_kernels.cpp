@@ -0,0 +1,704 @@
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#include <common.h>
+#include <filter_kernels.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FILTER_KERNELS_X86 1
+#include <hardware.h>
+#include <immintrin.h>
+#endif
+
+namespace {
+
+template <Comparison::Op op>
+using OpTag = std::integral_constant<Comparison::Op, op>;
+
+template <class F>
+void visit_op(Comparison::Op op, F&& f) {
+    switch (op) {
+    case Comparison::EQ:  return f(OpTag<Comparison::EQ>{});
+    case Comparison::NEQ: return f(OpTag<Comparison::NEQ>{});
+    case Comparison::LT:  return f(OpTag<Comparison::LT>{});
+    case Comparison::GT:  return f(OpTag<Comparison::GT>{});
+    case Comparison::LEQ: return f(OpTag<Comparison::LEQ>{});
+    case Comparison::GEQ: return f(OpTag<Comparison::GEQ>{});
+    default:              unreachable();
+    }
+}
+
+template <Comparison::Op op, class T>
+inline bool compare(T lhs, T rhs) {
+    if constexpr (op == Comparison::EQ) {
+        return lhs == rhs;
+    } else if constexpr (op == Comparison::NEQ) {
+        return lhs != rhs;
+    } else if constexpr (op == Comparison::LT) {
+        return lhs < rhs;
+    } else if constexpr (op == Comparison::GT) {
+        return lhs > rhs;
+    } else if constexpr (op == Comparison::LEQ) {
+        return lhs <= rhs;
+    } else {
+        return lhs >= rhs;
+    }
+}
+
+// Builds each output byte in a register instead of or'ing bit by bit into
+// memory, which lets the compiler keep the inner loop branch free.
+template <Comparison::Op op, class T>
+void compare_scalar(const T* __restrict__ data,
+    const uint8_t* __restrict__ bitmap,
+    uint8_t* __restrict__ output,
+    size_t size,
+    T      rhs) {
+    size_t num_bytes = (size + 7) / 8;
+    for (size_t byte_idx = 0; byte_idx < num_bytes; ++byte_idx) {
+        size_t  begin = byte_idx * 8;
+        size_t  count = std::min(size - begin, (size_t)8);
+        uint8_t mask  = 0;
+        for (size_t bit_idx = 0; bit_idx < count; ++bit_idx) {
+            mask |= static_cast<uint8_t>(compare<op>(data[begin + bit_idx], rhs)) << bit_idx;
+        }
+        output[byte_idx] = mask & bitmap[byte_idx];
+    }
+}
+
+// Small lists are compared value by value, larger ones are binary searched without
+// branches, the sorted list being at most a few cache lines.
+template <class T>
+inline bool in_list(T value, const T* values, size_t num_values) {
+    if (num_values <= IN_LIST_SIMD_VALUES) {
+        bool found = false;
+        for (size_t i = 0; i < num_values; ++i) {
+            found |= value == values[i];
+        }
+        return found;
+    }
+    const T* base = values;
+    size_t   n    = num_values;
+    while (n > 1) {
+        size_t half  = n / 2;
+        base        += (base[half] <= value) ? half : 0;
+        n           -= half;
+    }
+    return *base == value;
+}
+
+template <class T>
+void in_list_scalar(const T* __restrict__ data,
+    const uint8_t* __restrict__ bitmap,
+    uint8_t* __restrict__ output,
+    size_t   size,
+    const T* values,
+    size_t   num_values) {
+    size_t num_bytes = (size + 7) / 8;
+    for (size_t byte_idx = 0; byte_idx < num_bytes; ++byte_idx) {
+        size_t  begin = byte_idx * 8;
+        size_t  count = std::min(size - begin, (size_t)8);
+        uint8_t mask  = 0;
+        for (size_t bit_idx = 0; bit_idx < count; ++bit_idx) {
+            bool found  = in_list(data[begin + bit_idx], values, num_values);
+            mask       |= static_cast<uint8_t>(found) << bit_idx;
+        }
+        output[byte_idx] = mask & bitmap[byte_idx];
+    }
+}
+
+void code_lookup_scalar(const uint16_t* __restrict__ codes,
+    const uint8_t* __restrict__ bitmap,
+    uint8_t* __restrict__ output,
+    size_t size,
+    const uint8_t* __restrict__ matches) {
+    size_t num_bytes = (size + 7) / 8;
+    for (size_t byte_idx = 0; byte_idx < num_bytes; ++byte_idx) {
+        size_t  begin = byte_idx * 8;
+        size_t  count = std::min(size - begin, (size_t)8);
+        uint8_t mask  = 0;
+        for (size_t bit_idx = 0; bit_idx < count; ++bit_idx) {
+            mask |= matches[codes[begin + bit_idx]] << bit_idx;
+        }
+        output[byte_idx] = mask & bitmap[byte_idx];
+    }
+}
+
+// Evaluates `predicate` for the valid rows only and sets the bits of those that match.
+template <class Predicate>
+void branching_block(const uint8_t* __restrict__ bitmap,
+    uint8_t* __restrict__ output,
+    size_t      size,
+    Predicate&& predicate) {
+    size_t num_bytes = (size + 7) / 8;
+    for (size_t byte_idx = 0; byte_idx < num_bytes; ++byte_idx) {
+        size_t   begin = byte_idx * 8;
+        size_t   count = std::min(size - begin, (size_t)8);
+        uint32_t valid = bitmap[byte_idx] & ((1u << count) - 1);
+        uint8_t  mask  = 0;
+        for (; valid != 0; valid &= valid - 1) {
+            uint32_t bit_idx = __builtin_ctz(valid);
+            if (predicate(begin + bit_idx)) {
+                mask |= 1u << bit_idx;
+            }
+        }
+        output[byte_idx] = mask;
+    }
+}
+
+inline bool is_not_null(const uint8_t* bitmap, uint32_t row) {
+    return (bitmap[row / 8] >> (row % 8)) & 1;
+}
+
+// Keeps the selected rows that are not null and match, either storing only those or
+// storing every row and advancing the output by the outcome.
+template <bool branching, class Predicate>
+size_t select_rows(const uint8_t* __restrict__ bitmap,
+    const uint32_t* rows,
+    size_t          num_rows,
+    uint32_t*       output,
+    Predicate&&     predicate) {
+    size_t num_selected = 0;
+    for (size_t i = 0; i < num_rows; ++i) {
+        uint32_t row = rows[i];
+        if constexpr (branching) {
+            if (is_not_null(bitmap, row) and predicate(row)) {
+                output[num_selected++] = row;
+            }
+        } else {
+            output[num_selected]  = row;
+            num_selected         += is_not_null(bitmap, row) & predicate(row);
+        }
+    }
+    return num_selected;
+}
+
+template <class Predicate>
+size_t select_rows(SelectionKernel kernel,
+    const uint8_t* __restrict__ bitmap,
+    const uint32_t* rows,
+    size_t          num_rows,
+    uint32_t*       output,
+    Predicate&&     predicate) {
+    if (kernel == SelectionKernel::Branching) {
+        return select_rows<true>(bitmap, rows, num_rows, output, predicate);
+    }
+    return select_rows<false>(bitmap, rows, num_rows, output, predicate);
+}
+
+#ifdef FILTER_KERNELS_X86
+
+// The AVX2 compares only come as equal and greater than for integers, the other
+// operators are derived by swapping the operands or inverting the mask.
+template <Comparison::Op op>
+__attribute__((target("avx2"))) inline uint32_t avx2_mask(__m256i lhs, __m256i rhs, bool wide) {
+    __m256i  cmp;
+    uint32_t invert = wide ? 0x0f : 0xff;
+    if constexpr (op == Comparison::EQ or op == Comparison::NEQ) {
+        cmp = wide ? _mm256_cmpeq_epi64(lhs, rhs) : _mm256_cmpeq_epi32(lhs, rhs);
+    } else if constexpr (op == Comparison::GT or op == Comparison::LEQ) {
+        cmp = wide ? _mm256_cmpgt_epi64(lhs, rhs) : _mm256_cmpgt_epi32(lhs, rhs);
+    } else {
+        cmp = wide ? _mm256_cmpgt_epi64(rhs, lhs) : _mm256_cmpgt_epi32(rhs, lhs);
+    }
+    uint32_t mask = wide ? _mm256_movemask_pd(_mm256_castsi256_pd(cmp))
+                         : _mm256_movemask_ps(_mm256_castsi256_ps(cmp));
+    if constexpr (op == Comparison::NEQ or op == Comparison::LEQ or op == Comparison::GEQ) {
+        mask ^= invert;
+    }
+    return mask;
+}
+
+template <Comparison::Op op>
+constexpr int fp_predicate() {
+    switch (op) {
+    case Comparison::EQ:  return _CMP_EQ_OQ;
+    case Comparison::NEQ: return _CMP_NEQ_UQ;
+    case Comparison::LT:  return _CMP_LT_OQ;
+    case Comparison::GT:  return _CMP_GT_OQ;
+    case Comparison::LEQ: return _CMP_LE_OQ;
+    default:              return _CMP_GE_OQ;
+    }
+}
+
+// Eight values, one output byte per iteration.
+template <Comparison::Op op, class T>
+__attribute__((target("avx2"))) void compare_avx2(const T* __restrict__ data,
+    const uint8_t* __restrict__ bitmap,
+    uint8_t* __restrict__ output,
+    size_t size,
+    T      rhs) {
+    size_t num_bytes = size / 8;
+    if constexpr (std::is_same_v<T, int32_t>) {
+        __m256i value = _mm256_set1_epi32(rhs);
+        for (size_t byte_idx = 0; byte_idx < num_bytes; ++byte_idx) {
+            auto*   src = reinterpret_cast<const __m256i*>(data + byte_idx * 8);
+            __m256i lhs = _mm256_loadu_si256(src);
+            output[byte_idx] = avx2_mask<op>(lhs, value, false) & bitmap[byte_idx];
+        }
+    } else if constexpr (std::is_same_v<T, int64_t>) {
+        __m256i value = _mm256_set1_epi64x(rhs);
+        for (size_t byte_idx = 0; byte_idx < num_bytes; ++byte_idx) {
+            auto*    src = reinterpret_cast<const __m256i*>(data + byte_idx * 8);
+            uint32_t lo  = avx2_mask<op>(_mm256_loadu_si256(src), value, true);
+            uint32_t hi  = avx2_mask<op>(_mm256_loadu_si256(src + 1), value, true);
+            output[byte_idx] = (lo | hi << 4) & bitmap[byte_idx];
+        }
+    } else {
+        constexpr int predicate = fp_predicate<op>();
+        __m256d       value     = _mm256_set1_pd(rhs);
+        for (size_t byte_idx = 0; byte_idx < num_bytes; ++byte_idx) {
+            const double* src  = data + byte_idx * 8;
+            __m256d       lo   = _mm256_cmp_pd(_mm256_loadu_pd(src), value, predicate);
+            __m256d       hi   = _mm256_cmp_pd(_mm256_loadu_pd(src + 4), value, predicate);
+            uint32_t      mask = _mm256_movemask_pd(lo) | _mm256_movemask_pd(hi) << 4;
+            output[byte_idx] = mask & bitmap[byte_idx];
+        }
+    }
+    compare_scalar<op>(data + num_bytes * 8,
+        bitmap + num_bytes,
+        output + num_bytes,
+        size - num_bytes * 8,
+        rhs);
+}
+
+template <Comparison::Op op>
+constexpr int int_predicate() {
+    switch (op) {
+    case Comparison::EQ:  return _MM_CMPINT_EQ;
+    case Comparison::NEQ: return _MM_CMPINT_NE;
+    case Comparison::LT:  return _MM_CMPINT_LT;
+    case Comparison::GT:  return _MM_CMPINT_NLE;
+    case Comparison::LEQ: return _MM_CMPINT_LE;
+    default:              return _MM_CMPINT_NLT;
+    }
+}
+
+// The compares write straight into mask registers: 16 int32 values make two
+// output bytes, 8 int64 or fp64 values make one.
+template <Comparison::Op op, class T>
+__attribute__((target("avx512f"))) void compare_avx512(const T* __restrict__ data,
+    const uint8_t* __restrict__ bitmap,
+    uint8_t* __restrict__ output,
+    size_t size,
+    T      rhs) {
+    size_t num_bytes = 0;
+    if constexpr (std::is_same_v<T, int32_t>) {
+        __m512i value = _mm512_set1_epi32(rhs);
+        for (; num_bytes + 2 <= size / 8; num_bytes += 2) {
+            __m512i   lhs  = _mm512_loadu_si512(data + num_bytes * 8);
+            __mmask16 mask = _mm512_cmp_epi32_mask(lhs, value, int_predicate<op>());
+            uint16_t  valid;
+            std::memcpy(&valid, bitmap + num_bytes, sizeof(valid));
+            valid &= mask;
+            std::memcpy(output + num_bytes, &valid, sizeof(valid));
+        }
+    } else if constexpr (std::is_same_v<T, int64_t>) {
+        __m512i value = _mm512_set1_epi64(rhs);
+        for (; num_bytes < size / 8; ++num_bytes) {
+            __m512i  lhs  = _mm512_loadu_si512(data + num_bytes * 8);
+            __mmask8 mask = _mm512_cmp_epi64_mask(lhs, value, int_predicate<op>());
+            output[num_bytes] = mask & bitmap[num_bytes];
+        }
+    } else {
+        __m512d value = _mm512_set1_pd(rhs);
+        for (; num_bytes < size / 8; ++num_bytes) {
+            __m512d  lhs  = _mm512_loadu_pd(data + num_bytes * 8);
+            __mmask8 mask = _mm512_cmp_pd_mask(lhs, value, fp_predicate<op>());
+            output[num_bytes] = mask & bitmap[num_bytes];
+        }
+    }
+    compare_scalar<op>(data + num_bytes * 8,
+        bitmap + num_bytes,
+        output + num_bytes,
+        size - num_bytes * 8,
+        rhs);
+}
+
+// Every list value stays broadcast in its own register, and each block of rows is
+// compared against all of them before moving on.
+template <class T>
+__attribute__((target("avx2"))) void in_list_avx2(const T* __restrict__ data,
+    const uint8_t* __restrict__ bitmap,
+    uint8_t* __restrict__ output,
+    size_t   size,
+    const T* values,
+    size_t   num_values) {
+    size_t num_bytes = size / 8;
+    if constexpr (std::is_same_v<T, double>) {
+        __m256d needles[IN_LIST_SIMD_VALUES];
+        for (size_t i = 0; i < num_values; ++i) {
+            needles[i] = _mm256_set1_pd(values[i]);
+        }
+        for (size_t byte_idx = 0; byte_idx < num_bytes; ++byte_idx) {
+            __m256d lo  = _mm256_loadu_pd(data + byte_idx * 8);
+            __m256d hi  = _mm256_loadu_pd(data + byte_idx * 8 + 4);
+            __m256d flo = _mm256_setzero_pd();
+            __m256d fhi = _mm256_setzero_pd();
+            for (size_t i = 0; i < num_values; ++i) {
+                flo = _mm256_or_pd(flo, _mm256_cmp_pd(lo, needles[i], _CMP_EQ_OQ));
+                fhi = _mm256_or_pd(fhi, _mm256_cmp_pd(hi, needles[i], _CMP_EQ_OQ));
+            }
+            uint32_t mask = _mm256_movemask_pd(flo) | _mm256_movemask_pd(fhi) << 4;
+            output[byte_idx] = mask & bitmap[byte_idx];
+        }
+    } else {
+        constexpr bool wide = std::is_same_v<T, int64_t>;
+        __m256i        needles[IN_LIST_SIMD_VALUES];
+        for (size_t i = 0; i < num_values; ++i) {
+            needles[i] = wide ? _mm256_set1_epi64x(values[i]) : _mm256_set1_epi32(values[i]);
+        }
+        for (size_t byte_idx = 0; byte_idx < num_bytes; ++byte_idx) {
+            auto*    src  = reinterpret_cast<const __m256i*>(data + byte_idx * 8);
+            uint32_t mask = 0;
+            if constexpr (wide) {
+                uint32_t lo = 0, hi = 0;
+                for (size_t i = 0; i < num_values; ++i) {
+                    lo |= avx2_mask<Comparison::EQ>(_mm256_loadu_si256(src), needles[i], true);
+                    hi |= avx2_mask<Comparison::EQ>(_mm256_loadu_si256(src + 1),
+                        needles[i],
+                        true);
+                }
+                mask = lo | hi << 4;
+            } else {
+                __m256i lhs = _mm256_loadu_si256(src);
+                for (size_t i = 0; i < num_values; ++i) {
+                    mask |= avx2_mask<Comparison::EQ>(lhs, needles[i], false);
+                }
+            }
+            output[byte_idx] = mask & bitmap[byte_idx];
+        }
+    }
+    in_list_scalar(data + num_bytes * 8,
+        bitmap + num_bytes,
+        output + num_bytes,
+        size - num_bytes * 8,
+        values,
+        num_values);
+}
+
+template <class T>
+__attribute__((target("avx512f"))) void in_list_avx512(const T* __restrict__ data,
+    const uint8_t* __restrict__ bitmap,
+    uint8_t* __restrict__ output,
+    size_t   size,
+    const T* values,
+    size_t   num_values) {
+    size_t num_bytes = 0;
+    if constexpr (std::is_same_v<T, int32_t>) {
+        __m512i needles[IN_LIST_SIMD_VALUES];
+        for (size_t i = 0; i < num_values; ++i) {
+            needles[i] = _mm512_set1_epi32(values[i]);
+        }
+        for (; num_bytes + 2 <= size / 8; num_bytes += 2) {
+            __m512i   lhs  = _mm512_loadu_si512(data + num_bytes * 8);
+            __mmask16 mask = 0;
+            for (size_t i = 0; i < num_values; ++i) {
+                mask |= _mm512_cmpeq_epi32_mask(lhs, needles[i]);
+            }
+            uint16_t valid;
+            std::memcpy(&valid, bitmap + num_bytes, sizeof(valid));
+            valid &= mask;
+            std::memcpy(output + num_bytes, &valid, sizeof(valid));
+        }
+    } else if constexpr (std::is_same_v<T, int64_t>) {
+        __m512i needles[IN_LIST_SIMD_VALUES];
+        for (size_t i = 0; i < num_values; ++i) {
+            needles[i] = _mm512_set1_epi64(values[i]);
+        }
+        for (; num_bytes < size / 8; ++num_bytes) {
+            __m512i  lhs  = _mm512_loadu_si512(data + num_bytes * 8);
+            __mmask8 mask = 0;
+            for (size_t i = 0; i < num_values; ++i) {
+                mask |= _mm512_cmpeq_epi64_mask(lhs, needles[i]);
+            }
+            output[num_bytes] = mask & bitmap[num_bytes];
+        }
+    } else {
+        __m512d needles[IN_LIST_SIMD_VALUES];
+        for (size_t i = 0; i < num_values; ++i) {
+            needles[i] = _mm512_set1_pd(values[i]);
+        }
+        for (; num_bytes < size / 8; ++num_bytes) {
+            __m512d  lhs  = _mm512_loadu_pd(data + num_bytes * 8);
+            __mmask8 mask = 0;
+            for (size_t i = 0; i < num_values; ++i) {
+                mask |= _mm512_cmp_pd_mask(lhs, needles[i], _CMP_EQ_OQ);
+            }
+            output[num_bytes] = mask & bitmap[num_bytes];
+        }
+    }
+    in_list_scalar(data + num_bytes * 8,
+        bitmap + num_bytes,
+        output + num_bytes,
+        size - num_bytes * 8,
+        values,
+        num_values);
+}
+
+// The gathers read four bytes at the offset of each code, only the lowest one of which
+// belongs to it, hence the padding of the match table.
+__attribute__((target("avx2"))) void code_lookup_avx2(const uint16_t* __restrict__ codes,
+    const uint8_t* __restrict__ bitmap,
+    uint8_t* __restrict__ output,
+    size_t size,
+    const uint8_t* __restrict__ matches) {
+    size_t  num_bytes = size / 8;
+    auto*   base      = reinterpret_cast<const int*>(matches);
+    __m256i one       = _mm256_set1_epi32(1);
+    for (size_t byte_idx = 0; byte_idx < num_bytes; ++byte_idx) {
+        auto*   src     = reinterpret_cast<const __m128i*>(codes + byte_idx * 8);
+        __m256i indices = _mm256_cvtepu16_epi32(_mm_loadu_si128(src));
+        __m256i found   = _mm256_and_si256(_mm256_i32gather_epi32(base, indices, 1), one);
+        __m256i cmp     = _mm256_cmpeq_epi32(found, one);
+        output[byte_idx] = _mm256_movemask_ps(_mm256_castsi256_ps(cmp)) & bitmap[byte_idx];
+    }
+    code_lookup_scalar(codes + num_bytes * 8,
+        bitmap + num_bytes,
+        output + num_bytes,
+        size - num_bytes * 8,
+        matches);
+}
+
+__attribute__((target("avx512f"))) void code_lookup_avx512(const uint16_t* __restrict__ codes,
+    const uint8_t* __restrict__ bitmap,
+    uint8_t* __restrict__ output,
+    size_t size,
+    const uint8_t* __restrict__ matches) {
+    size_t  num_bytes = 0;
+    __m512i one       = _mm512_set1_epi32(1);
+    for (; num_bytes + 2 <= size / 8; num_bytes += 2) {
+        auto*     src     = reinterpret_cast<const __m256i*>(codes + num_bytes * 8);
+        __m512i   indices = _mm512_cvtepu16_epi32(_mm256_loadu_si256(src));
+        __m512i   found   = _mm512_i32gather_epi32(indices, matches, 1);
+        __mmask16 mask    = _mm512_test_epi32_mask(found, one);
+        uint16_t  valid;
+        std::memcpy(&valid, bitmap + num_bytes, sizeof(valid));
+        valid &= mask;
+        std::memcpy(output + num_bytes, &valid, sizeof(valid));
+    }
+    code_lookup_scalar(codes + num_bytes * 8,
+        bitmap + num_bytes,
+        output + num_bytes,
+        size - num_bytes * 8,
+        matches);
+}
+
+#endif
+
+} // namespace
+
+SimdLevel simd_level() {
+    static const SimdLevel level = [] {
+#ifdef FILTER_KERNELS_X86
+        if (has_avx512()) {
+            return SimdLevel::AVX512;
+        } else if (has_avx2()) {
+            return SimdLevel::AVX2;
+        }
+#endif
+        return SimdLevel::Scalar;
+    }();
+    return level;
+}
+
+template <class T>
+void compare_kernel(Comparison::Op op,
+    BlockKernel                    kernel,
+    const T* __restrict__ data,
+    const uint8_t* __restrict__ bitmap,
+    uint8_t* __restrict__ output,
+    size_t size,
+    T      rhs) {
+    visit_op(op, [&](auto tag) {
+        constexpr Comparison::Op value = decltype(tag)::value;
+        if (kernel.branching) {
+            return branching_block(bitmap, output, size, [data, rhs](size_t row) {
+                return compare<value>(data[row], rhs);
+            });
+        }
+        switch (kernel.level) {
+#ifdef FILTER_KERNELS_X86
+        case SimdLevel::AVX512: return compare_avx512<value>(data, bitmap, output, size, rhs);
+        case SimdLevel::AVX2:   return compare_avx2<value>(data, bitmap, output, size, rhs);
+#endif
+        default:                return compare_scalar<value>(data, bitmap, output, size, rhs);
+        }
+    });
+}
+
+template void compare_kernel<int32_t>(Comparison::Op,
+    BlockKernel,
+    const int32_t*,
+    const uint8_t*,
+    uint8_t*,
+    size_t,
+    int32_t);
+template void compare_kernel<int64_t>(Comparison::Op,
+    BlockKernel,
+    const int64_t*,
+    const uint8_t*,
+    uint8_t*,
+    size_t,
+    int64_t);
+template void compare_kernel<double>(Comparison::Op,
+    BlockKernel,
+    const double*,
+    const uint8_t*,
+    uint8_t*,
+    size_t,
+    double);
+
+template <class T>
+void in_list_kernel(BlockKernel kernel,
+    const T* __restrict__ data,
+    const uint8_t* __restrict__ bitmap,
+    uint8_t* __restrict__ output,
+    size_t   size,
+    const T* values,
+    size_t   num_values) {
+    if (kernel.branching) {
+        return branching_block(bitmap, output, size, [=](size_t row) {
+            return in_list(data[row], values, num_values);
+        });
+    }
+    if (num_values > IN_LIST_SIMD_VALUES) {
+        return in_list_scalar(data, bitmap, output, size, values, num_values);
+    }
+    switch (kernel.level) {
+#ifdef FILTER_KERNELS_X86
+    case SimdLevel::AVX512:
+        return in_list_avx512(data, bitmap, output, size, values, num_values);
+    case SimdLevel::AVX2: return in_list_avx2(data, bitmap, output, size, values, num_values);
+#endif
+    default: return in_list_scalar(data, bitmap, output, size, values, num_values);
+    }
+}
+
+template void in_list_kernel<int32_t>(BlockKernel,
+    const int32_t*,
+    const uint8_t*,
+    uint8_t*,
+    size_t,
+    const int32_t*,
+    size_t);
+template void in_list_kernel<int64_t>(BlockKernel,
+    const int64_t*,
+    const uint8_t*,
+    uint8_t*,
+    size_t,
+    const int64_t*,
+    size_t);
+template void in_list_kernel<double>(BlockKernel,
+    const double*,
+    const uint8_t*,
+    uint8_t*,
+    size_t,
+    const double*,
+    size_t);
+
+void code_lookup_kernel(BlockKernel kernel,
+    const uint16_t* __restrict__ codes,
+    const uint8_t* __restrict__ bitmap,
+    uint8_t* __restrict__ output,
+    size_t size,
+    const uint8_t* __restrict__ matches) {
+    if (kernel.branching) {
+        return branching_block(bitmap, output, size, [codes, matches](size_t row) {
+            return matches[codes[row]] != 0;
+        });
+    }
+    switch (kernel.level) {
+#ifdef FILTER_KERNELS_X86
+    case SimdLevel::AVX512: return code_lookup_avx512(codes, bitmap, output, size, matches);
+    case SimdLevel::AVX2:   return code_lookup_avx2(codes, bitmap, output, size, matches);
+#endif
+    default:                return code_lookup_scalar(codes, bitmap, output, size, matches);
+    }
+}
+
+template <class T>
+size_t select_kernel(Comparison::Op op,
+    SelectionKernel                 kernel,
+    const T* __restrict__ data,
+    const uint8_t* __restrict__ bitmap,
+    const uint32_t* rows,
+    size_t          num_rows,
+    uint32_t*       output,
+    T               rhs) {
+    size_t num_selected = 0;
+    visit_op(op, [&](auto tag) {
+        constexpr Comparison::Op value = decltype(tag)::value;
+        num_selected                   = select_rows(kernel,
+            bitmap,
+            rows,
+            num_rows,
+            output,
+            [data, rhs](uint32_t row) { return compare<value>(data[row], rhs); });
+    });
+    return num_selected;
+}
+
+template size_t select_kernel<int32_t>(Comparison::Op,
+    SelectionKernel,
+    const int32_t*,
+    const uint8_t*,
+    const uint32_t*,
+    size_t,
+    uint32_t*,
+    int32_t);
+template size_t select_kernel<int64_t>(Comparison::Op,
+    SelectionKernel,
+    const int64_t*,
+    const uint8_t*,
+    const uint32_t*,
+    size_t,
+    uint32_t*,
+    int64_t);
+template size_t select_kernel<double>(Comparison::Op,
+    SelectionKernel,
+    const double*,
+    const uint8_t*,
+    const uint32_t*,
+    size_t,
+    uint32_t*,
+    double);
+
+template <class T>
+size_t in_list_select_kernel(SelectionKernel kernel,
+    const T* __restrict__ data,
+    const uint8_t* __restrict__ bitmap,
+    const uint32_t* rows,
+    size_t          num_rows,
+    uint32_t*       output,
+    const T*        values,
+    size_t          num_values) {
+    return select_rows(kernel, bitmap, rows, num_rows, output, [=](uint32_t row) {
+        return in_list(data[row], values, num_values);
+    });
+}
+
+template size_t in_list_select_kernel<int32_t>(SelectionKernel,
+    const int32_t*,
+    const uint8_t*,
+    const uint32_t*,
+    size_t,
+    uint32_t*,
+    const int32_t*,
+    size_t);
+template size_t in_list_select_kernel<int64_t>(SelectionKernel,
+    const int64_t*,
+    const uint8_t*,
+    const uint32_t*,
+    size_t,
+    uint32_t*,
+    const int64_t*,
+    size_t);
+template size_t in_list_select_kernel<double>(SelectionKernel,
+    const double*,
+    const uint8_t*,
+    const uint32_t*,
+    size_t,
+    uint32_t*,
+    const double*,
+    size_t);
@@ -0,0 +1,63 @@
+#include <fmt/core.h>
+
+#include <kernel_bandit.h>
+
+void KernelBandit::reset(std::initializer_list<const char*> variant_names) {
+    num_variants = 0;
+    for (auto* name: variant_names) {
+        names[num_variants] = name;
+        cost[num_variants].store(0, std::memory_order_relaxed);
+        uses[num_variants].store(0, std::memory_order_relaxed);
+        ++num_variants;
+    }
+    calls.store(0, std::memory_order_relaxed);
+}
+
+size_t KernelBandit::choose() {
+    uint64_t call = calls.fetch_add(1, std::memory_order_relaxed);
+    if (num_variants < 2) {
+        return 0;
+    }
+    if (call < WARMUP_CALLS * num_variants) {
+        return call % num_variants;
+    }
+    size_t best = 0;
+    for (size_t variant = 1; variant < num_variants; ++variant) {
+        if (cost[variant].load(std::memory_order_relaxed)
+            < cost[best].load(std::memory_order_relaxed)) {
+            best = variant;
+        }
+    }
+    if (call % EXPLORE_PERIOD == 0) {
+        return (best + 1 + call / EXPLORE_PERIOD % (num_variants - 1)) % num_variants;
+    }
+    return best;
+}
+
+// Concurrent updates of the average may overwrite each other, which only drops samples.
+void KernelBandit::record(size_t variant, uint64_t cycles, size_t num_rows) {
+    uses[variant].fetch_add(1, std::memory_order_relaxed);
+    if (num_rows == 0) {
+        return;
+    }
+    float sample  = static_cast<float>(cycles) / num_rows;
+    float average = cost[variant].load(std::memory_order_relaxed);
+    cost[variant].store(average == 0 ? sample : average * 0.75f + sample * 0.25f,
+        std::memory_order_relaxed);
+}
+
+std::string KernelBandit::summary() const {
+    std::string ret;
+    for (size_t variant = 0; variant < num_variants; ++variant) {
+        uint64_t num_uses = uses[variant].load(std::memory_order_relaxed);
+        if (num_uses == 0) {
+            continue;
+        }
+        ret += fmt::format("{}{} x{} {:.2f} c/row",
+            ret.empty() ? "" : ", ",
+            names[variant],
+            num_uses,
+            cost[variant].load(std::memory_order_relaxed));
+    }
+    return ret.empty() ? "unused" : ret;
+}
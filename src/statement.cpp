@@ -1,137 +1,351 @@
-#include <cassert>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
 
 #include <common.h>
+#include <hardware.h>
 #include <inner_column.h>
 #include <plan.h>
 #include <statement.h>
 
-std::vector<uint8_t> bitmap_not(std::vector<uint8_t> bitmap) {
-    auto task = [&bitmap](size_t begin, size_t end) {
-        for (size_t i = begin; i < end; ++i) {
-            bitmap[i] = ~bitmap[i];
+std::vector<uint8_t> Statement::eval(const std::vector<const InnerColumnBase*>& table) const {
+    prepare(table);
+    size_t               num_rows   = table.front()->size();
+    size_t               num_bytes  = (num_rows + 7) / 8;
+    size_t               num_blocks = (num_bytes + FILTER_BLOCK_BYTES - 1) / FILTER_BLOCK_BYTES;
+    std::vector<uint8_t> ret(num_bytes);
+    auto                 task = [this, &table, &ret, num_bytes](size_t begin, size_t end) {
+        for (size_t block_idx = begin; block_idx < end; ++block_idx) {
+            size_t byte_begin = block_idx * FILTER_BLOCK_BYTES;
+            size_t byte_end   = std::min(byte_begin + FILTER_BLOCK_BYTES, num_bytes);
+            eval_block(table, byte_begin, byte_end, ret.data() + byte_begin);
         }
     };
-    filter_tp.run(task, bitmap.size());
-    return bitmap;
+    filter_tp.run(task, num_blocks);
+    // NOT sets the bits past the last row.
+    if (num_rows % 8 != 0) {
+        ret.back() &= (1u << (num_rows % 8)) - 1;
+    }
+    return ret;
 }
 
-std::vector<uint8_t> bitmap_and(const std::vector<uint8_t>& lhs,
-    const std::vector<uint8_t>&                             rhs) {
-    std::vector<uint8_t> ret;
-    assert(lhs.size() == rhs.size());
-    ret.resize(lhs.size());
-    auto task = [&lhs, &rhs, &ret](size_t begin, size_t end) {
-        for (size_t i = begin; i < end; ++i) {
-            ret[i] = lhs[i] & rhs[i];
-        }
-    };
-    filter_tp.run(task, lhs.size());
-    return ret;
+// Evaluates a string predicate once per dictionary entry of an encoded column, so that
+// the blocks only look up the codes. Returns nullptr if the column is not encoded.
+template <class Predicate>
+static const InnerColumnBase* encode_matches(const InnerColumnBase* c,
+    std::vector<uint8_t>&                                           matches,
+    Predicate&&                                                     predicate) {
+    if (c->type != DataType::VARCHAR) {
+        return nullptr;
+    }
+    auto column = reinterpret_cast<const InnerColumn<std::string>*>(c);
+    if (not column->encoded()) {
+        return nullptr;
+    }
+    matches.assign(column->dictionary.size() + CODE_LOOKUP_PADDING, 0);
+    for (size_t code = 0; code < column->dictionary.size(); ++code) {
+        matches[code] = predicate(column->dictionary[code]);
+    }
+    return column;
 }
 
-std::vector<uint8_t> bitmap_or(const std::vector<uint8_t>& lhs,
-    const std::vector<uint8_t>&                            rhs) {
-    std::vector<uint8_t> ret;
-    assert(lhs.size() == rhs.size());
-    ret.resize(lhs.size());
-    auto task = [&lhs, &rhs, &ret](size_t begin, size_t end) {
-        for (size_t i = begin; i < end; ++i) {
-            ret[i] = lhs[i] | rhs[i];
+template <class Column>
+void null_block(const Column* column,
+    bool                      is_null,
+    size_t                    byte_begin,
+    size_t                    byte_end,
+    uint8_t*                  output) {
+    uint8_t flip = is_null ? 0xff : 0x00;
+    for (size_t byte_idx = byte_begin; byte_idx < byte_end; ++byte_idx) {
+        output[byte_idx - byte_begin] = column->bitmap[byte_idx] ^ flip;
+    }
+}
+
+template <class Column>
+size_t null_selection(const Column* column,
+    bool                            is_null,
+    const uint32_t*                 rows,
+    size_t                          num_rows,
+    uint32_t*                       output) {
+    size_t num_selected = 0;
+    for (size_t i = 0; i < num_rows; ++i) {
+        uint32_t row          = rows[i];
+        output[num_selected]  = row;
+        num_selected         += column->is_not_null(row) != is_null;
+    }
+    return num_selected;
+}
+
+// Run the variant of a block or selection kernel the bandit picks and charge it the
+// cycles it took. The last block variant is the branching kernel, see reset_kernels.
+template <class Kernel>
+static void run_block_variant(KernelBandit& bandit,
+    size_t                                  byte_begin,
+    size_t                                  byte_end,
+    Kernel&&                                kernel) {
+    size_t   variant = bandit.choose();
+    uint64_t start   = read_tsc();
+    if (variant + 1 == bandit.num_variants) {
+        kernel(BlockKernel(SimdLevel::Scalar, true));
+    } else {
+        kernel(BlockKernel(simd_variant(variant)));
+    }
+    bandit.record(variant, read_tsc() - start, (byte_end - byte_begin) * 8);
+}
+
+template <class Kernel>
+static size_t run_selection_variant(KernelBandit& bandit, size_t num_rows, Kernel&& kernel) {
+    size_t   variant      = bandit.choose();
+    uint64_t start        = read_tsc();
+    size_t   num_selected = kernel(static_cast<SelectionKernel>(variant));
+    bandit.record(variant, read_tsc() - start, num_rows);
+    return num_selected;
+}
+
+// Block kernels over plain strings are not vectorized and only come branch-free or
+// branching, the others are also tried at the SIMD levels of simd_variant.
+static void reset_kernels(KernelBandit& block_kernels,
+    KernelBandit&                       selection_kernels,
+    bool                                vectorized) {
+    if (not vectorized) {
+        block_kernels.reset({"branch-free", "branching"});
+    } else if (simd_level() == SimdLevel::Scalar) {
+        block_kernels.reset({simd_level_name(SimdLevel::Scalar), "branching"});
+    } else {
+        block_kernels.reset({
+            simd_level_name(simd_variant(0)),
+            simd_level_name(simd_variant(1)),
+            "branching",
+        });
+    }
+    selection_kernels.reset({"branch-free", "branching"});
+}
+
+// Whether the block kernels of a predicate on `c` are vectorized, that is all but those
+// filtering plain strings.
+static bool vectorized(const InnerColumnBase* c, const InnerColumnBase* encoded_column) {
+    return c->type != DataType::VARCHAR or encoded_column == c;
+}
+
+void Comparison::eval_block(const std::vector<const InnerColumnBase*>& table,
+    size_t                                                             byte_begin,
+    size_t                                                             byte_end,
+    uint8_t*                                                           output) const {
+    auto* c = table[column];
+    switch (c->type) {
+    case DataType::INT32: {
+        auto column = reinterpret_cast<const InnerColumn<int32_t>*>(c);
+        if (op == IS_NULL or op == IS_NOT_NULL) {
+            return null_block(column, op == IS_NULL, byte_begin, byte_end, output);
         }
-    };
-    filter_tp.run(task, lhs.size());
-    return ret;
+        auto comp_value = static_cast<int32_t>(std::get<int64_t>(value));
+        return run_block_variant(block_kernels, byte_begin, byte_end, [&](BlockKernel kernel) {
+            column->compare_block(op, comp_value, byte_begin, byte_end, output, kernel);
+        });
+    }
+    case DataType::INT64: {
+        auto column = reinterpret_cast<const InnerColumn<int64_t>*>(c);
+        if (op == IS_NULL or op == IS_NOT_NULL) {
+            return null_block(column, op == IS_NULL, byte_begin, byte_end, output);
+        }
+        auto comp_value = std::get<int64_t>(value);
+        return run_block_variant(block_kernels, byte_begin, byte_end, [&](BlockKernel kernel) {
+            column->compare_block(op, comp_value, byte_begin, byte_end, output, kernel);
+        });
+    }
+    case DataType::FP64: {
+        auto column = reinterpret_cast<const InnerColumn<double>*>(c);
+        if (op == IS_NULL or op == IS_NOT_NULL) {
+            return null_block(column, op == IS_NULL, byte_begin, byte_end, output);
+        }
+        auto comp_value = std::get<double>(value);
+        return run_block_variant(block_kernels, byte_begin, byte_end, [&](BlockKernel kernel) {
+            column->compare_block(op, comp_value, byte_begin, byte_end, output, kernel);
+        });
+    }
+    case DataType::VARCHAR: {
+        auto column = reinterpret_cast<const InnerColumn<std::string>*>(c);
+        if (op == IS_NULL or op == IS_NOT_NULL) {
+            return null_block(column, op == IS_NULL, byte_begin, byte_end, output);
+        }
+        if (encoded_column == c) {
+            auto lookup = [&](BlockKernel kernel) {
+                column->lookup_block(code_matches, byte_begin, byte_end, output, kernel);
+            };
+            return run_block_variant(block_kernels, byte_begin, byte_end, lookup);
+        }
+        if (op == LIKE or op == NOT_LIKE) {
+            bool negate  = op == NOT_LIKE;
+            auto matches = [this, negate](std::string_view value) {
+                return like.match(value) != negate;
+            };
+            auto block = [&](BlockKernel kernel) {
+                column->filter_block(byte_begin, byte_end, output, kernel, matches);
+            };
+            return run_block_variant(block_kernels, byte_begin, byte_end, block);
+        }
+        auto& comp_value = std::get<std::string>(value);
+        return run_block_variant(block_kernels, byte_begin, byte_end, [&](BlockKernel kernel) {
+            column->compare_block(op, comp_value, byte_begin, byte_end, output, kernel);
+        });
+    }
+    }
+    unreachable();
 }
 
-std::vector<uint8_t> Comparison::eval(const std::vector<const InnerColumnBase*>& table) const {
+size_t Comparison::eval_selection(const std::vector<const InnerColumnBase*>& table,
+    const uint32_t*                                                        rows,
+    size_t                                                                 num_rows,
+    uint32_t*                                                              output) const {
     auto* c = table[column];
     switch (c->type) {
     case DataType::INT32: {
         auto column = reinterpret_cast<const InnerColumn<int32_t>*>(c);
-        if (op == IS_NULL) {
-            return bitmap_not(column->bitmap);
-        } else if (op == IS_NOT_NULL) {
-            return column->bitmap;
-        } else {
-            auto comp_value = static_cast<int32_t>(std::get<int64_t>(value));
-            switch (op) {
-            case EQ:  return column->equal(comp_value);
-            case NEQ: return column->not_equal(comp_value);
-            case LT:  return column->less(comp_value);
-            case GT:  return column->greater(comp_value);
-            case LEQ: return column->less_equal(comp_value);
-            case GEQ: return column->greater_equal(comp_value);
-            default:  unreachable();
-            }
+        if (op == IS_NULL or op == IS_NOT_NULL) {
+            return null_selection(column, op == IS_NULL, rows, num_rows, output);
         }
-        break;
+        auto comp_value = static_cast<int32_t>(std::get<int64_t>(value));
+        return run_selection_variant(selection_kernels, num_rows, [&](SelectionKernel kernel) {
+            return column->compare_selection(op, comp_value, rows, num_rows, output, kernel);
+        });
     }
     case DataType::INT64: {
         auto column = reinterpret_cast<const InnerColumn<int64_t>*>(c);
-        if (op == IS_NULL) {
-            return bitmap_not(column->bitmap);
-        } else if (op == IS_NOT_NULL) {
-            return column->bitmap;
-        } else {
-            auto comp_value = std::get<int64_t>(value);
-            switch (op) {
-            case EQ:  return column->equal(comp_value);
-            case NEQ: return column->not_equal(comp_value);
-            case LT:  return column->less(comp_value);
-            case GT:  return column->greater(comp_value);
-            case LEQ: return column->less_equal(comp_value);
-            case GEQ: return column->greater_equal(comp_value);
-            default:  unreachable();
-            }
+        if (op == IS_NULL or op == IS_NOT_NULL) {
+            return null_selection(column, op == IS_NULL, rows, num_rows, output);
         }
-        break;
+        auto comp_value = std::get<int64_t>(value);
+        return run_selection_variant(selection_kernels, num_rows, [&](SelectionKernel kernel) {
+            return column->compare_selection(op, comp_value, rows, num_rows, output, kernel);
+        });
     }
     case DataType::FP64: {
         auto column = reinterpret_cast<const InnerColumn<double>*>(c);
-        if (op == IS_NULL) {
-            return bitmap_not(column->bitmap);
-        } else if (op == IS_NOT_NULL) {
-            return column->bitmap;
-        } else {
-            auto comp_value = std::get<double>(value);
-            switch (op) {
-            case EQ:  return column->equal(comp_value);
-            case NEQ: return column->not_equal(comp_value);
-            case LT:  return column->less(comp_value);
-            case GT:  return column->greater(comp_value);
-            case LEQ: return column->less_equal(comp_value);
-            case GEQ: return column->greater_equal(comp_value);
-            default:  unreachable();
-            }
+        if (op == IS_NULL or op == IS_NOT_NULL) {
+            return null_selection(column, op == IS_NULL, rows, num_rows, output);
         }
-        break;
+        auto comp_value = std::get<double>(value);
+        return run_selection_variant(selection_kernels, num_rows, [&](SelectionKernel kernel) {
+            return column->compare_selection(op, comp_value, rows, num_rows, output, kernel);
+        });
     }
     case DataType::VARCHAR: {
         auto column = reinterpret_cast<const InnerColumn<std::string>*>(c);
-        if (op == IS_NULL) {
-            return bitmap_not(column->bitmap);
-        } else if (op == IS_NOT_NULL) {
-            return column->bitmap;
-        } else {
-            auto& comp_value = std::get<std::string>(value);
-            switch (op) {
-            case EQ:       return column->equal(comp_value);
-            case NEQ:      return column->not_equal(comp_value);
-            case LT:       return column->less(comp_value);
-            case GT:       return column->greater(comp_value);
-            case LEQ:      return column->less_equal(comp_value);
-            case GEQ:      return column->greater_equal(comp_value);
-            case LIKE:     return column->like(comp_value);
-            case NOT_LIKE: return column->not_like(comp_value);
-            default:       unreachable();
-            }
+        if (op == IS_NULL or op == IS_NOT_NULL) {
+            return null_selection(column, op == IS_NULL, rows, num_rows, output);
         }
-        break;
+        if (encoded_column == c) {
+            auto lookup = [&](SelectionKernel kernel) {
+                return column->lookup_selection(code_matches, rows, num_rows, output, kernel);
+            };
+            return run_selection_variant(selection_kernels, num_rows, lookup);
+        }
+        if (op == LIKE or op == NOT_LIKE) {
+            bool negate  = op == NOT_LIKE;
+            auto matches = [this, negate](std::string_view value) {
+                return like.match(value) != negate;
+            };
+            auto select = [&](SelectionKernel kernel) {
+                return column->filter_selection(rows, num_rows, output, kernel, matches);
+            };
+            return run_selection_variant(selection_kernels, num_rows, select);
+        }
+        auto& comp_value = std::get<std::string>(value);
+        return run_selection_variant(selection_kernels, num_rows, [&](SelectionKernel kernel) {
+            return column->compare_selection(op, comp_value, rows, num_rows, output, kernel);
+        });
     }
     }
     unreachable();
 }
 
+double Comparison::estimated_cost(const std::vector<const InnerColumnBase*>& table) const {
+    if (op == IS_NULL or op == IS_NOT_NULL) {
+        return 0.1;
+    }
+    if (table[column]->type != DataType::VARCHAR) {
+        return 0.5;
+    }
+    if (encoded_column) {
+        return 1;
+    }
+    if (op == LIKE or op == NOT_LIKE) {
+        return like.kind == LikePattern::REGEX ? 200 : 20;
+    }
+    return 10;
+}
+
+void Comparison::prepare(const std::vector<const InnerColumnBase*>& table) const {
+    encoded_column = nullptr;
+    if (op != IS_NULL and op != IS_NOT_NULL) {
+        encoded_column = encode_matches(table[column],
+            code_matches,
+            [this](std::string_view value) { return match_string(value); });
+    }
+    reset_kernels(block_kernels, selection_kernels, vectorized(table[column], encoded_column));
+}
+
+std::string Comparison::kernel_report(int indent) const {
+    return fmt::format("{}: blocks {}; selections {}",
+        pretty_print(indent),
+        block_kernels.summary(),
+        selection_kernels.summary());
+}
+
+bool Comparison::match_string(std::string_view str) const {
+    std::string_view rhs = std::get<std::string>(value);
+    switch (op) {
+    case EQ:       return str == rhs;
+    case NEQ:      return str != rhs;
+    case LT:       return str < rhs;
+    case GT:       return str > rhs;
+    case LEQ:      return str <= rhs;
+    case GEQ:      return str >= rhs;
+    case LIKE:     return like.match(str);
+    case NOT_LIKE: return not like.match(str);
+    default:       unreachable();
+    }
+}
+
+LikePattern::LikePattern(std::string pattern)
+: pattern(std::move(pattern)) {
+    if (this->pattern.find('_') != std::string::npos) {
+        kind = REGEX;
+        return;
+    }
+    std::vector<std::string> parts;
+    size_t                   begin = 0;
+    for (;;) {
+        size_t end = this->pattern.find('%', begin);
+        parts.emplace_back(this->pattern.substr(begin, end - begin));
+        if (end == std::string::npos) {
+            break;
+        }
+        begin = end + 1;
+    }
+    prefix = std::move(parts.front());
+    if (parts.size() == 1) {
+        kind = EXACT;
+        return;
+    }
+    suffix = std::move(parts.back());
+    for (size_t i = 1; i + 1 < parts.size(); ++i) {
+        if (not parts[i].empty()) {
+            middle.emplace_back(std::move(parts[i]));
+        }
+    }
+    if (middle.empty() and suffix.empty()) {
+        kind = PREFIX;
+    } else if (middle.empty() and prefix.empty()) {
+        kind = SUFFIX;
+    } else if (middle.size() == 1 and prefix.empty() and suffix.empty()) {
+        kind = CONTAINS;
+    } else {
+        kind = SEGMENTS;
+    }
+}
+
 bool Comparison::eval(const std::vector<Data>& record) const {
     const Data& record_data = record[column];
     const auto& comp_value  = value;
@@ -148,7 +362,7 @@ bool Comparison::eval(const std::vector<Data>& record) const {
         if (!record_str || !comp_str) {
             return false;
         }
-        bool match = like_match(*record_str, *comp_str);
+        bool match = like.match(*record_str);
         return (op == LIKE) ? match : !match;
     } else {
         auto record_num = get_numeric_value(record_data);
@@ -183,22 +397,566 @@ bool Comparison::eval(const std::vector<Data>& record) const {
     }
 }
 
-std::vector<uint8_t> LogicalOperation::eval(
+template <class T>
+static std::vector<T> sorted_distinct(std::vector<T> values) {
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    return values;
+}
+
+InList::InList(size_t col, std::vector<Literal> vals)
+: column(col)
+, values(std::move(vals)) {
+    for (auto& value: values) {
+        if (auto* i = std::get_if<int64_t>(&value)) {
+            // Values outside of the INT32 range can never match an INT32 column.
+            if (*i >= std::numeric_limits<int32_t>::min()
+                and *i <= std::numeric_limits<int32_t>::max()) {
+                int32_values.push_back(static_cast<int32_t>(*i));
+            }
+            int64_values.push_back(*i);
+            fp64_values.push_back(static_cast<double>(*i));
+        } else if (auto* d = std::get_if<double>(&value)) {
+            fp64_values.push_back(*d);
+        } else if (auto* str = std::get_if<std::string>(&value)) {
+            string_values.push_back(*str);
+        }
+    }
+    int32_values  = sorted_distinct(std::move(int32_values));
+    int64_values  = sorted_distinct(std::move(int64_values));
+    fp64_values   = sorted_distinct(std::move(fp64_values));
+    string_values = sorted_distinct(std::move(string_values));
+    for (auto& str: string_values) {
+        string_set.insert(str);
+    }
+}
+
+std::string InList::pretty_print(int indent) const {
+    std::string list;
+    for (auto& value: values) {
+        if (not list.empty()) {
+            list += ", ";
+        }
+        list += Comparison(column, Comparison::EQ, value).valueToString();
+    }
+    return fmt::format("{:{}}{} IN ({})", "", indent, column, list);
+}
+
+std::string InList::kernel_report(int indent) const {
+    return fmt::format("{}: blocks {}; selections {}",
+        pretty_print(indent),
+        block_kernels.summary(),
+        selection_kernels.summary());
+}
+
+bool InList::eval(const std::vector<Data>& record) const {
+    const Data& record_data = record[column];
+    if (auto* str = std::get_if<std::string>(&record_data)) {
+        return string_set.count(*str) != 0;
+    }
+    auto record_num = Comparison::get_numeric_value(record_data);
+    return record_num.has_value()
+       and std::binary_search(fp64_values.begin(), fp64_values.end(), *record_num);
+}
+
+void InList::eval_block(const std::vector<const InnerColumnBase*>& table,
+    size_t                                                         byte_begin,
+    size_t                                                         byte_end,
+    uint8_t*                                                       output) const {
+    auto* c = table[column];
+    switch (c->type) {
+    case DataType::INT32: {
+        auto column = reinterpret_cast<const InnerColumn<int32_t>*>(c);
+        return run_block_variant(block_kernels, byte_begin, byte_end, [&](BlockKernel kernel) {
+            column->in_list_block(int32_values, byte_begin, byte_end, output, kernel);
+        });
+    }
+    case DataType::INT64: {
+        auto column = reinterpret_cast<const InnerColumn<int64_t>*>(c);
+        return run_block_variant(block_kernels, byte_begin, byte_end, [&](BlockKernel kernel) {
+            column->in_list_block(int64_values, byte_begin, byte_end, output, kernel);
+        });
+    }
+    case DataType::FP64: {
+        auto column = reinterpret_cast<const InnerColumn<double>*>(c);
+        return run_block_variant(block_kernels, byte_begin, byte_end, [&](BlockKernel kernel) {
+            column->in_list_block(fp64_values, byte_begin, byte_end, output, kernel);
+        });
+    }
+    case DataType::VARCHAR: {
+        auto column = reinterpret_cast<const InnerColumn<std::string>*>(c);
+        if (encoded_column == c) {
+            auto lookup = [&](BlockKernel kernel) {
+                column->lookup_block(code_matches, byte_begin, byte_end, output, kernel);
+            };
+            return run_block_variant(block_kernels, byte_begin, byte_end, lookup);
+        }
+        return run_block_variant(block_kernels, byte_begin, byte_end, [&](BlockKernel kernel) {
+            column->filter_block(byte_begin,
+                byte_end,
+                output,
+                kernel,
+                [this](std::string_view value) { return string_set.count(value) != 0; });
+        });
+    }
+    }
+    unreachable();
+}
+
+size_t InList::eval_selection(const std::vector<const InnerColumnBase*>& table,
+    const uint32_t*                                                    rows,
+    size_t                                                             num_rows,
+    uint32_t*                                                          output) const {
+    auto* c = table[column];
+    switch (c->type) {
+    case DataType::INT32: {
+        auto column = reinterpret_cast<const InnerColumn<int32_t>*>(c);
+        return run_selection_variant(selection_kernels, num_rows, [&](SelectionKernel kernel) {
+            return column->in_list_selection(int32_values, rows, num_rows, output, kernel);
+        });
+    }
+    case DataType::INT64: {
+        auto column = reinterpret_cast<const InnerColumn<int64_t>*>(c);
+        return run_selection_variant(selection_kernels, num_rows, [&](SelectionKernel kernel) {
+            return column->in_list_selection(int64_values, rows, num_rows, output, kernel);
+        });
+    }
+    case DataType::FP64: {
+        auto column = reinterpret_cast<const InnerColumn<double>*>(c);
+        return run_selection_variant(selection_kernels, num_rows, [&](SelectionKernel kernel) {
+            return column->in_list_selection(fp64_values, rows, num_rows, output, kernel);
+        });
+    }
+    case DataType::VARCHAR: {
+        auto column = reinterpret_cast<const InnerColumn<std::string>*>(c);
+        if (encoded_column == c) {
+            auto lookup = [&](SelectionKernel kernel) {
+                return column->lookup_selection(code_matches, rows, num_rows, output, kernel);
+            };
+            return run_selection_variant(selection_kernels, num_rows, lookup);
+        }
+        return run_selection_variant(selection_kernels, num_rows, [&](SelectionKernel kernel) {
+            return column->filter_selection(rows,
+                num_rows,
+                output,
+                kernel,
+                [this](std::string_view value) { return string_set.count(value) != 0; });
+        });
+    }
+    }
+    unreachable();
+}
+
+double InList::estimated_cost(const std::vector<const InnerColumnBase*>& table) const {
+    if (table[column]->type != DataType::VARCHAR) {
+        return fp64_values.size() > IN_LIST_SIMD_VALUES ? 4 : 1;
+    }
+    return encoded_column ? 1 : 20;
+}
+
+void InList::prepare(const std::vector<const InnerColumnBase*>& table) const {
+    encoded_column = encode_matches(table[column],
+        code_matches,
+        [this](std::string_view value) { return string_set.count(value) != 0; });
+    reset_kernels(block_kernels, selection_kernels, vectorized(table[column], encoded_column));
+}
+
+std::unique_ptr<Statement> LikeAny::merge(std::unique_ptr<Statement>& l,
+    std::unique_ptr<Statement>&                                        r) {
+    auto like_column = [](const Statement* statement) -> std::optional<size_t> {
+        if (auto* any = dynamic_cast<const LikeAny*>(statement)) {
+            return any->column;
+        }
+        auto* comparison = dynamic_cast<const Comparison*>(statement);
+        if (comparison
+            and (comparison->op == Comparison::LIKE or comparison->op == Comparison::NOT_LIKE)
+            and std::holds_alternative<std::string>(comparison->value)) {
+            return comparison->column;
+        }
+        return std::nullopt;
+    };
+    auto column = like_column(l.get());
+    if (not column or column != like_column(r.get())) {
+        return nullptr;
+    }
+    std::unique_ptr<LikeAny> ret;
+    for (auto* side: {&l, &r}) {
+        if (auto* any = dynamic_cast<LikeAny*>(side->get())) {
+            if (not ret) {
+                ret.reset(static_cast<LikeAny*>(side->release()));
+                continue;
+            }
+            for (auto& term: any->terms) {
+                ret->terms.push_back(std::move(term));
+            }
+            side->reset();
+        } else {
+            if (not ret) {
+                ret = std::make_unique<LikeAny>(*column);
+            }
+            ret->terms.emplace_back(static_cast<Comparison*>(side->release()));
+        }
+    }
+    ret->compile();
+    return ret;
+}
+
+void LikeAny::compile() {
+    patterns.clear();
+    negated_patterns.clear();
+    regex_set.reset();
+    for (auto& term: terms) {
+        if (term->op == Comparison::NOT_LIKE) {
+            negated_patterns.push_back(&term->like);
+        } else if (term->like.kind != LikePattern::REGEX) {
+            patterns.push_back(&term->like);
+        } else {
+            if (not regex_set) {
+                regex_set = std::make_unique<RE2::Set>(RE2::Options(), RE2::ANCHOR_BOTH);
+            }
+            regex_set->Add(Comparison::like_to_regex(term->like.pattern), nullptr);
+        }
+    }
+    if (regex_set) {
+        regex_set->Compile();
+    }
+}
+
+std::string LikeAny::pretty_print(int indent) const {
+    std::string result = fmt::format("{:{}}[OR]\n", "", indent);
+    for (auto& term: terms) {
+        result += term->pretty_print(indent + 2) + "\n";
+    }
+    result.pop_back();
+    return result;
+}
+
+std::string LikeAny::kernel_report(int indent) const {
+    return fmt::format("{:{}}{} LIKE any of {}: blocks {}; selections {}",
+        "",
+        indent,
+        column,
+        terms.size(),
+        block_kernels.summary(),
+        selection_kernels.summary());
+}
+
+bool LikeAny::eval(const std::vector<Data>& record) const {
+    for (auto& term: terms) {
+        if (term->eval(record)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void LikeAny::prepare(const std::vector<const InnerColumnBase*>& table) const {
+    encoded_column = encode_matches(table[column],
+        code_matches,
+        [this](std::string_view value) { return match(value); });
+    reset_kernels(block_kernels, selection_kernels, vectorized(table[column], encoded_column));
+}
+
+void LikeAny::eval_block(const std::vector<const InnerColumnBase*>& table,
+    size_t                                                          byte_begin,
+    size_t                                                          byte_end,
+    uint8_t*                                                        output) const {
+    auto* c      = table[column];
+    auto  column = reinterpret_cast<const InnerColumn<std::string>*>(c);
+    if (encoded_column == c) {
+        return run_block_variant(block_kernels, byte_begin, byte_end, [&](BlockKernel kernel) {
+            column->lookup_block(code_matches, byte_begin, byte_end, output, kernel);
+        });
+    }
+    run_block_variant(block_kernels, byte_begin, byte_end, [&](BlockKernel kernel) {
+        column->filter_block(byte_begin,
+            byte_end,
+            output,
+            kernel,
+            [this](std::string_view value) { return match(value); });
+    });
+}
+
+size_t LikeAny::eval_selection(const std::vector<const InnerColumnBase*>& table,
+    const uint32_t*                                                     rows,
+    size_t                                                              num_rows,
+    uint32_t*                                                           output) const {
+    auto* c      = table[column];
+    auto  column = reinterpret_cast<const InnerColumn<std::string>*>(c);
+    if (encoded_column == c) {
+        return run_selection_variant(selection_kernels, num_rows, [&](SelectionKernel kernel) {
+            return column->lookup_selection(code_matches, rows, num_rows, output, kernel);
+        });
+    }
+    return run_selection_variant(selection_kernels, num_rows, [&](SelectionKernel kernel) {
+        return column->filter_selection(rows,
+            num_rows,
+            output,
+            kernel,
+            [this](std::string_view value) { return match(value); });
+    });
+}
+
+double LikeAny::estimated_cost(const std::vector<const InnerColumnBase*>& table) const {
+    if (encoded_column) {
+        return 1;
+    }
+    return 20 * (patterns.size() + negated_patterns.size()) + (regex_set ? 200 : 0);
+}
+
+void LogicalOperation::add_child(std::unique_ptr<Statement> child) {
+    auto* logical = dynamic_cast<LogicalOperation*>(child.get());
+    if (logical and logical->op_type == op_type and op_type != NOT) {
+        for (auto& grandchild: logical->children) {
+            add_child(std::move(grandchild));
+        }
+        return;
+    }
+    if (op_type == OR) {
+        for (auto& sibling: children) {
+            if (auto merged = LikeAny::merge(sibling, child)) {
+                sibling = std::move(merged);
+                return;
+            }
+        }
+    }
+    children.push_back(std::move(child));
+}
+
+void LogicalOperation::prepare(const std::vector<const InnerColumnBase*>& table) const {
+    stats = std::vector<ChildStats>(children.size());
+    selection_builders.reset({"branch-free", "branching"});
+    for (size_t child_idx = 0; child_idx < children.size(); ++child_idx) {
+        children[child_idx]->prepare(table);
+        stats[child_idx].estimated_cost = children[child_idx]->estimated_cost(table);
+    }
+}
+
+double LogicalOperation::estimated_cost(
     const std::vector<const InnerColumnBase*>& table) const {
+    double cost = 0;
+    for (auto& child_stats: stats) {
+        cost += child_stats.estimated_cost;
+    }
+    return cost;
+}
+
+// A term of a conjunction decides the rows it drops, one of a disjunction those it keeps.
+// Terms not measured yet are assumed to decide half of the rows.
+std::vector<size_t> LogicalOperation::ranked_children() const {
+    std::vector<double> ranks(children.size());
+    for (size_t child_idx = 0; child_idx < children.size(); ++child_idx) {
+        auto&    child_stats = stats[child_idx];
+        uint64_t rows_in     = child_stats.rows_in.load(std::memory_order_relaxed);
+        double   cost        = child_stats.estimated_cost;
+        double   decided     = 0.5;
+        if (rows_in > 0) {
+            double rows_out = child_stats.rows_out.load(std::memory_order_relaxed);
+            cost     = double(child_stats.cycles.load(std::memory_order_relaxed)) / rows_in;
+            decided  = op_type == AND ? 1 - rows_out / rows_in : rows_out / rows_in;
+        }
+        ranks[child_idx] = cost / std::max(decided, 1e-3);
+    }
+    std::vector<size_t> order(children.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&ranks](size_t l, size_t r) {
+        return ranks[l] < ranks[r];
+    });
+    return order;
+}
+
+static size_t count_selected(const uint8_t* bitmap, size_t num_bytes) {
+    size_t count = 0;
+    size_t i     = 0;
+    for (; i + 8 <= num_bytes; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bitmap + i, sizeof(word));
+        count += __builtin_popcountll(word);
+    }
+    for (; i < num_bytes; ++i) {
+        count += __builtin_popcount(bitmap[i]);
+    }
+    return count;
+}
+
+// Row ids of the set bits of a block, without the bits NOT sets past the last row. The
+// branching variant loops over the set bits, the branch-free one over all of them.
+template <bool branching>
+static size_t bitmap_to_selection(const uint8_t* bitmap,
+    size_t                                       byte_begin,
+    size_t                                       num_bytes,
+    size_t                                       num_rows,
+    uint32_t*                                    rows) {
+    size_t num_selected = 0;
+    for (size_t i = 0; i < num_bytes; ++i) {
+        uint32_t bits = bitmap[i];
+        uint32_t base = (byte_begin + i) * 8;
+        if constexpr (branching) {
+            while (bits) {
+                rows[num_selected++]  = base + __builtin_ctz(bits);
+                bits                 &= bits - 1;
+            }
+        } else {
+            for (uint32_t bit_idx = 0; bit_idx < 8; ++bit_idx) {
+                rows[num_selected]  = base + bit_idx;
+                num_selected       += (bits >> bit_idx) & 1;
+            }
+        }
+    }
+    while (num_selected > 0 and rows[num_selected - 1] >= num_rows) {
+        --num_selected;
+    }
+    return num_selected;
+}
+
+static void selection_to_bitmap(const uint32_t* rows,
+    size_t                                      num_rows,
+    size_t                                      byte_begin,
+    size_t                                      num_bytes,
+    uint8_t*                                    bitmap) {
+    std::memset(bitmap, 0, num_bytes);
+    for (size_t i = 0; i < num_rows; ++i) {
+        size_t bit       = rows[i] - byte_begin * 8;
+        bitmap[bit / 8] |= 1u << (bit % 8);
+    }
+}
+
+// Writes the rows of `rows` that are not in `removed`, a subsequence of it, to output,
+// which may alias `rows`.
+static size_t selection_difference(const uint32_t* rows,
+    size_t                                         num_rows,
+    const uint32_t*                                removed,
+    size_t                                         num_removed,
+    uint32_t*                                      output) {
+    size_t num_selected = 0;
+    size_t removed_idx  = 0;
+    for (size_t i = 0; i < num_rows; ++i) {
+        if (removed_idx < num_removed and removed[removed_idx] == rows[i]) {
+            ++removed_idx;
+        } else {
+            output[num_selected++] = rows[i];
+        }
+    }
+    return num_selected;
+}
+
+// Children write into a block sized scratch buffer that is folded into the output right
+// away, so no bitmap of the whole table is materialized below the root. Once few rows are
+// left, the remaining terms of a conjunction only visit those through a selection vector.
+void LogicalOperation::eval_block(const std::vector<const InnerColumnBase*>& table,
+    size_t                                                                   byte_begin,
+    size_t                                                                   byte_end,
+    uint8_t*                                                                 output) const {
+    size_t num_bytes = byte_end - byte_begin;
+    if (op_type == NOT) {
+        children[0]->eval_block(table, byte_begin, byte_end, output);
+        for (size_t i = 0; i < num_bytes; ++i) {
+            output[i] = ~output[i];
+        }
+        return;
+    }
+    size_t  num_rows = std::min(byte_end * 8, table.front()->size()) - byte_begin * 8;
+    auto    order    = ranked_children();
+    uint8_t scratch[FILTER_BLOCK_BYTES];
+    for (size_t i = 0; i < order.size(); ++i) {
+        if (i > 0 and op_type == AND
+            and count_selected(output, num_bytes) * SELECTION_VECTOR_DENSITY < num_bytes * 8) {
+            uint32_t rows[FILTER_BLOCK_BYTES * 8];
+            auto     build = [&](SelectionKernel kernel) {
+                auto variant = kernel == SelectionKernel::Branching ? bitmap_to_selection<true>
+                                                                    : bitmap_to_selection<false>;
+                return variant(output, byte_begin, num_bytes, byte_begin * 8 + num_rows, rows);
+            };
+            size_t num_selected = run_selection_variant(selection_builders, num_rows, build);
+            for (; i < order.size() and num_selected > 0; ++i) {
+                uint64_t start  = read_tsc();
+                size_t   passed = children[order[i]]->eval_selection(table,
+                    rows,
+                    num_selected,
+                    rows);
+                observe(order[i], read_tsc() - start, num_selected, passed);
+                num_selected = passed;
+            }
+            return selection_to_bitmap(rows, num_selected, byte_begin, num_bytes, output);
+        }
+        uint8_t* child_output = i == 0 ? output : scratch;
+        uint64_t start        = read_tsc();
+        children[order[i]]->eval_block(table, byte_begin, byte_end, child_output);
+        size_t   passed       = count_selected(child_output, num_bytes);
+        observe(order[i], read_tsc() - start, num_rows, passed);
+        if (i == 0) {
+            continue;
+        }
+        if (op_type == AND) {
+            for (size_t byte_idx = 0; byte_idx < num_bytes; ++byte_idx) {
+                output[byte_idx] &= scratch[byte_idx];
+            }
+        } else {
+            for (size_t byte_idx = 0; byte_idx < num_bytes; ++byte_idx) {
+                output[byte_idx] |= scratch[byte_idx];
+            }
+        }
+    }
+}
+
+size_t LogicalOperation::eval_selection(const std::vector<const InnerColumnBase*>& table,
+    const uint32_t*                                                              rows,
+    size_t                                                                       num_rows,
+    uint32_t*                                                                    output) const {
     switch (op_type) {
     case AND: {
-        return bitmap_and(children[0]->eval(table), children[1]->eval(table));
+        for (size_t child_idx: ranked_children()) {
+            uint64_t start  = read_tsc();
+            size_t   passed = children[child_idx]->eval_selection(table,
+                rows,
+                num_rows,
+                output);
+            observe(child_idx, read_tsc() - start, num_rows, passed);
+            rows     = output;
+            num_rows = passed;
+        }
+        return num_rows;
     }
     case OR: {
-        return bitmap_or(children[0]->eval(table), children[1]->eval(table));
+        // Each term only visits the rows that no earlier one matched.
+        std::vector<uint32_t> remaining(rows, rows + num_rows);
+        std::vector<uint32_t> matched(num_rows);
+        for (size_t child_idx: ranked_children()) {
+            uint64_t start       = read_tsc();
+            size_t   num_matched = children[child_idx]->eval_selection(table,
+                remaining.data(),
+                remaining.size(),
+                matched.data());
+            observe(child_idx, read_tsc() - start, remaining.size(), num_matched);
+            remaining.resize(selection_difference(remaining.data(),
+                remaining.size(),
+                matched.data(),
+                num_matched,
+                remaining.data()));
+        }
+        return selection_difference(rows, num_rows, remaining.data(), remaining.size(), output);
     }
     case NOT: {
-        return bitmap_not(children[0]->eval(table));
+        std::vector<uint32_t> matched(num_rows);
+        size_t num_matched = children[0]->eval_selection(table, rows, num_rows, matched.data());
+        return selection_difference(rows, num_rows, matched.data(), num_matched, output);
     }
     }
     unreachable();
 }
 
+std::string LogicalOperation::kernel_report(int indent) const {
+    std::string result = pretty_print(indent);
+    result.resize(result.find('\n'));
+    if (op_type == AND) {
+        result += fmt::format(" selection vectors: {}", selection_builders.summary());
+    }
+    for (auto& child: children) {
+        result += "\n" + child->kernel_report(indent + 2);
+    }
+    return result;
+}
+
 bool LogicalOperation::eval(const std::vector<Data>& record) const {
     switch (op_type) {
     case AND: {
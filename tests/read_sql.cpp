@@ -597,38 +597,27 @@ void parse_expr_impl(hsql::Expr*                                     expr,
                 extract_column_and_table(left, table_counts, column_to_tables, alias_map);
             // fmt::println("left_column: {}", left_column);
             // fmt::println("left_table: {}", left_table);
+            std::vector<Literal> values;
             for (auto [idx, item]: list | views::enumerate) {
-                Literal value;
                 switch (item->type) {
                 case hsql::kExprLiteralInt: {
                     // fmt::println("item {}: int literal: {}", idx, item->ival);
-                    value = item->ival;
+                    values.emplace_back(item->ival);
                     break;
                 }
                 case hsql::kExprLiteralString: {
                     // fmt::println("item {}: string literal: {}", idx, item->name);
-                    value = item->name;
+                    values.emplace_back(std::string(item->name));
                     break;
                 }
                 default:
                     throw std::runtime_error(
                         fmt::format("Expression type: {} not processed", item->type));
                 }
-                if (not out_statement) {
-                    out_statement =
-                        std::make_unique<Comparison>(column_idx(left_column, left_entity),
-                            Comparison::Op::EQ,
-                            std::move(value));
-                } else {
-                    auto new_stmt =
-                        std::make_unique<Comparison>(column_idx(left_column, left_entity),
-                            Comparison::Op::EQ,
-                            std::move(value));
-                    out_statement =
-                        LogicalOperation::makeOr(std::move(out_statement), std::move(new_stmt));
-                }
             }
-            out_entity = std::move(left_entity);
+            out_statement = std::make_unique<InList>(column_idx(left_column, left_entity),
+                std::move(values));
+            out_entity    = std::move(left_entity);
             break;
         }
         case hsql::kOpIsNull: {
@@ -1104,11 +1093,6 @@ Plan load_join_pipeline(const json& node, const ParsedSQL& parsed_sql) {
             if (auto itr = filters.find(entity); itr != filters.end()) {
                 filter = itr->second.get();
             }
-            auto table        = Table::from_csv(*pattributes,
-                fs::path("imdb") / fmt::format("{}.csv", entity.table),
-                filter);
-            auto new_input_id = ret.new_input(std::move(table));
-            // auto new_input_id = ret.new_table(std::move(table));
             std::vector<std::tuple<TableEntity, std::string, DataType>> output_columns;
             std::vector<std::tuple<size_t, DataType>>                   output_attrs;
             for (const auto& [required_entity, required_column]: required_attrs) {
@@ -1132,6 +1116,17 @@ Plan load_join_pipeline(const json& node, const ParsedSQL& parsed_sql) {
                         required_column));
                 }
             }
+            // Only the columns read by the plan are materialized.
+            std::vector<size_t> projection;
+            for (const auto& [input_idx, _]: output_attrs) {
+                projection.push_back(input_idx);
+            }
+            auto table        = Table::from_csv(*pattributes,
+                fs::path("imdb") / fmt::format("{}.csv", entity.table),
+                filter,
+                &projection);
+            auto new_input_id = ret.new_input(std::move(table));
+            // auto new_input_id = ret.new_table(std::move(table));
             auto new_node_id = ret.new_scan_node(new_input_id, std::move(output_attrs));
             return {new_node_id, std::move(output_columns)};
         } else {
@@ -1,9 +1,17 @@
 #include "hardware.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
 
 #include <algorithm>
+#include <columnar_exec.h>
 #include <cstdint>
+#include <filesystem>
+#include <filter_kernels.h>
+#include <fstream>
 #include <german_table.h>
+#include <hardware__talos.h>
+#include <inner_column.h>
+#include <map>
 #include <plan.h>
 #include <table.h>
 
@@ -473,10 +481,1863 @@ TEST_CASE("Build on right", "[join]") {
     REQUIRE(result_table.table() == ground_truth);
 }
 
+TEST_CASE("Build on left with different inputs", "[join]") {
+    Plan plan;
+    plan.new_scan_node(0,
+        {
+            {0, DataType::INT32  },
+            {1, DataType::VARCHAR}
+    });
+    plan.new_scan_node(1,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT64}
+    });
+    plan.new_join_node(true,
+        0,
+        1,
+        0,
+        0,
+        {
+            {1, DataType::VARCHAR},
+            {3, DataType::INT64  }
+    });
+    using namespace std::string_literals;
+    std::vector<std::vector<Data>> data1{
+        {3, "ccc"s},
+        {1, "aaa"s},
+    };
+    std::vector<std::vector<Data>> data2{
+        {1,                int64_t(10)},
+        {2,                int64_t(20)},
+        {std::monostate{}, int64_t(30)},
+        {3,                int64_t(40)},
+        {1,                int64_t(50)},
+    };
+    Table         table1(std::move(data1), {DataType::INT32, DataType::VARCHAR});
+    Table         table2(std::move(data2), {DataType::INT32, DataType::INT64});
+    ColumnarTable input1 = table1.to_columnar();
+    ColumnarTable input2 = table2.to_columnar();
+    plan.inputs.emplace_back(std::move(input1));
+    plan.inputs.emplace_back(std::move(input2));
+    plan.root     = 2;
+    auto* context = Contest::build_context();
+    auto  result  = Contest::execute(plan, context);
+    Contest::destroy_context(context);
+    REQUIRE(result.num_rows == 3);
+    REQUIRE(result.columns.size() == 2);
+    auto                           result_table = Table::from_columnar(result);
+    std::vector<std::vector<Data>> ground_truth{
+        {"aaa"s, int64_t(10)},
+        {"aaa"s, int64_t(50)},
+        {"ccc"s, int64_t(40)},
+    };
+    sort(result_table.table());
+    REQUIRE(result_table.table() == ground_truth);
+}
+
+TEST_CASE("Clustered gather matches order preserving gather", "[join]") {
+    Plan plan;
+    plan.new_scan_node(0,
+        {
+            {0, DataType::INT32  },
+            {1, DataType::VARCHAR}
+    });
+    plan.new_scan_node(1,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT64}
+    });
+    plan.new_join_node(true,
+        0,
+        1,
+        0,
+        0,
+        {
+            {3, DataType::INT64  },
+            {1, DataType::VARCHAR},
+            {0, DataType::INT32  }
+    });
+    // Build side is larger than a gather cluster and probe keys arrive in
+    // reverse order so the build row ids of the matches are not sorted.
+    std::vector<std::vector<Data>> data1, data2;
+    for (int32_t i = 0; i < 20000; ++i) {
+        data1.push_back({i, fmt::format("v{}", i)});
+    }
+    for (int32_t i = 30000; i >= 0; i -= 3) {
+        data2.push_back({i % 20000, int64_t(i)});
+    }
+    Table table1(std::move(data1), {DataType::INT32, DataType::VARCHAR});
+    Table table2(std::move(data2), {DataType::INT32, DataType::INT64});
+    plan.inputs.emplace_back(table1.to_columnar());
+    plan.inputs.emplace_back(table2.to_columnar());
+    plan.root = 2;
+
+    ColumnarExecutor ordered;
+    ordered.gather_order = GatherOrder::OrderPreserving;
+    ColumnarExecutor clustered;
+    clustered.gather_order = GatherOrder::Clustered;
+    auto expected          = Table::from_columnar(ordered.execute_impl(plan, plan.root));
+    auto result            = Table::from_columnar(clustered.execute_impl(plan, plan.root));
+    REQUIRE(result.number_rows() == 10001);
+    REQUIRE(result.table() == expected.table());
+}
+
+TEST_CASE("Join with a heavy hitter on the build side", "[join]") {
+    Plan plan;
+    plan.new_scan_node(0, {{0, DataType::INT32}});
+    plan.new_scan_node(1,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT64}
+    });
+    plan.new_join_node(true,
+        0,
+        1,
+        0,
+        0,
+        {
+            {0, DataType::INT32},
+            {2, DataType::INT64}
+    });
+    // Half of the build rows share key 0, the other half are unique. Key 0 is
+    // probed twice so its build rows are expanded for more than one probe row.
+    std::vector<std::vector<Data>> data1, data2;
+    for (int32_t i = 0; i < 80000; ++i) {
+        data1.push_back({i % 2 == 0 ? 0 : i});
+    }
+    for (int32_t i = 0; i < 8; ++i) {
+        data2.push_back({i, int64_t(i)});
+    }
+    data2.push_back({0, int64_t(100)});
+    Table table1(std::move(data1), {DataType::INT32});
+    Table table2(std::move(data2), {DataType::INT32, DataType::INT64});
+    plan.inputs.emplace_back(table1.to_columnar());
+    plan.inputs.emplace_back(table2.to_columnar());
+    plan.root = 2;
+
+    ColumnarExecutor executor;
+    auto             result = Table::from_columnar(executor.execute_impl(plan, plan.root));
+    std::map<std::pair<int32_t, int64_t>, size_t> counts;
+    for (auto& record: result.table()) {
+        ++counts[{std::get<int32_t>(record[0]), std::get<int64_t>(record[1])}];
+    }
+    REQUIRE(result.number_rows() == 2 * 40000 + 4);
+    REQUIRE(counts[{0, 0}] == 40000);
+    REQUIRE(counts[{0, 100}] == 40000);
+    REQUIRE(counts[{1, 1}] == 1);
+    REQUIRE(counts[{3, 3}] == 1);
+    REQUIRE(counts[{5, 5}] == 1);
+    REQUIRE(counts[{7, 7}] == 1);
+    REQUIRE(counts[{2, 2}] == 0);
+}
+
+TEST_CASE("Join on FP64 keys", "[join]") {
+    Plan plan;
+    plan.new_scan_node(0,
+        {
+            {0, DataType::FP64}
+    });
+    plan.new_scan_node(1,
+        {
+            {0, DataType::FP64}
+    });
+    plan.new_join_node(true,
+        0,
+        1,
+        0,
+        0,
+        {
+            {0, DataType::FP64},
+            {1, DataType::FP64}
+    });
+    // Keys that only differ after the decimal point or in sign must not match.
+    std::vector<std::vector<Data>> data1{
+        {1.0},
+        {1.5},
+        {-2.0},
+        {0.0},
+    };
+    std::vector<std::vector<Data>> data2{
+        {1.5},
+        {2.0},
+        {-2.0},
+        {-0.0},
+    };
+    Table table1(std::move(data1), {DataType::FP64});
+    Table table2(std::move(data2), {DataType::FP64});
+    plan.inputs.emplace_back(table1.to_columnar());
+    plan.inputs.emplace_back(table2.to_columnar());
+    plan.root     = 2;
+    auto* context = Contest::build_context();
+    auto  result  = Contest::execute(plan, context);
+    Contest::destroy_context(context);
+    auto result_table = Table::from_columnar(result);
+    sort(result_table.table());
+    std::vector<std::vector<Data>> ground_truth{
+        {-2.0, -2.0},
+        {0.0,  -0.0},
+        {1.5,  1.5 },
+    };
+    REQUIRE(result_table.table() == ground_truth);
+}
+
+TEST_CASE("Join on a unique build side", "[join]") {
+    Plan plan;
+    plan.new_scan_node(0,
+        {
+            {0, DataType::INT32}
+    });
+    plan.new_scan_node(1,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT64}
+    });
+    plan.new_join_node(true,
+        0,
+        1,
+        0,
+        0,
+        {
+            {2, DataType::INT64},
+            {0, DataType::INT32}
+    });
+    // Build keys are unique and dense, probe keys fall below, inside and above
+    // the build key range.
+    std::vector<std::vector<Data>> data1, data2;
+    for (int32_t i = -10; i < 90; ++i) {
+        if (i % 10 == 0) {
+            data1.push_back({std::monostate{}});
+        } else {
+            data1.push_back({i});
+        }
+    }
+    for (int32_t i = -20; i < 100; i += 5) {
+        data2.push_back({i, int64_t(i) * 2});
+    }
+    data2.push_back({std::monostate{}, int64_t(0)});
+    Table table1(std::move(data1), {DataType::INT32});
+    Table table2(std::move(data2), {DataType::INT32, DataType::INT64});
+    plan.inputs.emplace_back(table1.to_columnar());
+    plan.inputs.emplace_back(table2.to_columnar());
+    plan.root     = 2;
+    auto* context = Contest::build_context();
+    auto  result  = Contest::execute(plan, context);
+    Contest::destroy_context(context);
+    auto result_table = Table::from_columnar(result);
+    sort(result_table.table());
+    std::vector<std::vector<Data>> ground_truth;
+    for (int32_t i = -5; i < 90; i += 10) {
+        ground_truth.push_back({int64_t(i) * 2, i});
+    }
+    sort(ground_truth);
+    REQUIRE(result_table.table() == ground_truth);
+}
+
+TEST_CASE("Join on a small build side with duplicate keys", "[join]") {
+    Plan plan;
+    plan.new_scan_node(0,
+        {
+            {0, DataType::INT64}
+    });
+    plan.new_scan_node(1,
+        {
+            {0, DataType::INT64}
+    });
+    plan.new_join_node(false,
+        0,
+        1,
+        0,
+        0,
+        {
+            {1, DataType::INT64},
+            {0, DataType::INT64}
+    });
+    // The build side is too large for a single comparison block so it is
+    // probed through the sorted keys.
+    std::vector<std::vector<Data>> data1, data2;
+    for (int64_t i = 0; i < 40; ++i) {
+        data1.push_back({i});
+    }
+    for (int64_t i = 0; i < 90; ++i) {
+        data2.push_back({i % 30});
+    }
+    Table table1(std::move(data1), {DataType::INT64});
+    Table table2(std::move(data2), {DataType::INT64});
+    plan.inputs.emplace_back(table1.to_columnar());
+    plan.inputs.emplace_back(table2.to_columnar());
+    plan.root     = 2;
+    auto* context = Contest::build_context();
+    auto  result  = Contest::execute(plan, context);
+    Contest::destroy_context(context);
+    auto result_table = Table::from_columnar(result);
+    sort(result_table.table());
+    std::vector<std::vector<Data>> ground_truth;
+    for (int64_t i = 0; i < 30; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            ground_truth.push_back({i, i});
+        }
+    }
+    REQUIRE(result_table.table() == ground_truth);
+}
+
+TEST_CASE("Root join writes its output while probing", "[join]") {
+    Plan plan;
+    plan.new_scan_node(0,
+        {
+            {0, DataType::INT32},
+            {1, DataType::VARCHAR}
+    });
+    plan.new_scan_node(1,
+        {
+            {0, DataType::INT32}
+    });
+    plan.new_join_node(true,
+        0,
+        1,
+        0,
+        0,
+        {
+            {2, DataType::INT32},
+            {1, DataType::VARCHAR},
+            {0, DataType::INT32}
+    });
+    // The output spans many batches and pages, build strings are partly null
+    // and some probe keys have no match.
+    std::vector<std::vector<Data>> data1, data2;
+    for (int32_t i = 0; i < 2000; ++i) {
+        if (i % 7 == 0) {
+            data1.push_back({i, std::monostate{}});
+        } else {
+            data1.push_back({i, "value" + std::to_string(i)});
+        }
+    }
+    for (int32_t i = 0; i < 6000; ++i) {
+        data2.push_back({i % 2500});
+    }
+    Table table1(std::move(data1), {DataType::INT32, DataType::VARCHAR});
+    Table table2(std::move(data2), {DataType::INT32});
+    plan.inputs.emplace_back(table1.to_columnar());
+    plan.inputs.emplace_back(table2.to_columnar());
+    plan.root     = 2;
+    auto* context = Contest::build_context();
+    auto  result  = Contest::execute(plan, context);
+    Contest::destroy_context(context);
+    auto result_table = Table::from_columnar(result);
+    sort(result_table.table());
+    std::vector<std::vector<Data>> ground_truth;
+    for (int32_t i = 0; i < 6000; ++i) {
+        int32_t key = i % 2500;
+        if (key >= 2000) {
+            continue;
+        }
+        if (key % 7 == 0) {
+            ground_truth.push_back({key, std::monostate{}, key});
+        } else {
+            ground_truth.push_back({key, "value" + std::to_string(key), key});
+        }
+    }
+    sort(ground_truth);
+    REQUIRE(result_table.table() == ground_truth);
+}
+
+TEST_CASE("Join over the memory budget spills to disk", "[join]") {
+    Plan plan;
+    plan.new_scan_node(0,
+        {
+            {0, DataType::INT32},
+            {1, DataType::VARCHAR}
+    });
+    plan.new_scan_node(1,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT64}
+    });
+    plan.new_join_node(true,
+        0,
+        1,
+        0,
+        0,
+        {
+            {1, DataType::VARCHAR},
+            {3, DataType::INT64},
+            {0, DataType::INT32}
+    });
+    plan.new_join_node(false,
+        2,
+        1,
+        2,
+        0,
+        {
+            {0, DataType::VARCHAR},
+            {4, DataType::INT64},
+            {1, DataType::INT64}
+    });
+    // Both joins have build sides larger than the smallest hash table, with
+    // duplicate and null keys.
+    std::vector<std::vector<Data>> data1, data2;
+    for (int32_t i = 0; i < 20000; ++i) {
+        if (i % 13 == 0) {
+            data1.push_back({std::monostate{}, "null" + std::to_string(i)});
+        } else {
+            data1.push_back({i % 9000, "value" + std::to_string(i)});
+        }
+    }
+    for (int32_t i = 0; i < 15000; ++i) {
+        data2.push_back({i % 12000, int64_t(i)});
+    }
+    Table table1(std::move(data1), {DataType::INT32, DataType::VARCHAR});
+    Table table2(std::move(data2), {DataType::INT32, DataType::INT64});
+    plan.inputs.emplace_back(table1.to_columnar());
+    plan.inputs.emplace_back(table2.to_columnar());
+    plan.root = 3;
+
+    ColumnarExecutor in_memory;
+    ColumnarExecutor spilling;
+    spilling.memory_budget = 1;
+    auto expected          = Table::from_columnar(in_memory.execute_impl(plan, plan.root));
+    auto result            = Table::from_columnar(spilling.execute_impl(plan, plan.root));
+    REQUIRE(spilling.memory_in_use == 0);
+    REQUIRE(result.number_rows() == expected.number_rows());
+    sort(result.table());
+    sort(expected.table());
+    REQUIRE(result.table() == expected.table());
+}
+
+TEST_CASE("Join probing another join runs as a pipeline", "[join]") {
+    Plan plan;
+    plan.new_scan_node(0,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT64}
+    });
+    plan.new_scan_node(1,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT32}
+    });
+    plan.new_scan_node(2,
+        {
+            {0, DataType::INT32},
+            {1, DataType::VARCHAR}
+    });
+    plan.new_join_node(true,
+        0,
+        1,
+        0,
+        0,
+        {
+            {3, DataType::INT32},
+            {1, DataType::INT64}
+    });
+    plan.new_join_node(false,
+        3,
+        2,
+        0,
+        0,
+        {
+            {3, DataType::VARCHAR},
+            {1, DataType::INT64}
+    });
+    std::vector<std::vector<Data>> data1, data2, data3;
+    for (int32_t i = 0; i < 5000; ++i) {
+        data1.push_back({i % 4000, int64_t(i)});
+    }
+    for (int32_t i = 0; i < 30000; ++i) {
+        data2.push_back({i % 5000, i % 700});
+    }
+    for (int32_t i = 0; i < 700; i += 2) {
+        data3.push_back({i, "value" + std::to_string(i)});
+    }
+    Table table1(std::move(data1), {DataType::INT32, DataType::INT64});
+    Table table2(std::move(data2), {DataType::INT32, DataType::INT32});
+    Table table3(std::move(data3), {DataType::INT32, DataType::VARCHAR});
+    plan.inputs.emplace_back(table1.to_columnar());
+    plan.inputs.emplace_back(table2.to_columnar());
+    plan.inputs.emplace_back(table3.to_columnar());
+    plan.root = 4;
+
+    // Every row of the scan is pushed through both probes on its own.
+    ColumnarExecutor materialized;
+    materialized.batch_rows = 0;
+    ColumnarExecutor pipelined;
+    pipelined.batch_rows = 1;
+    auto expected        = Table::from_columnar(materialized.execute_impl(plan, plan.root));
+    auto result          = Table::from_columnar(pipelined.execute_impl(plan, plan.root));
+    REQUIRE(result.number_rows() == expected.number_rows());
+    REQUIRE(result.number_rows() > 0);
+    sort(result.table());
+    sort(expected.table());
+    REQUIRE(result.table() == expected.table());
+}
+
+TEST_CASE("Pipeline decodes morsels across long strings and nulls", "[join]") {
+    Plan plan;
+    plan.new_scan_node(0,
+        {
+            {0, DataType::INT32},
+            {1, DataType::VARCHAR}
+    });
+    plan.new_scan_node(1,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT32}
+    });
+    plan.new_scan_node(2,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT64}
+    });
+    plan.new_scan_node(3, {{0, DataType::INT64}});
+    plan.new_join_node(false,
+        0,
+        1,
+        0,
+        0,
+        {
+            {1, DataType::VARCHAR},
+            {3, DataType::INT32}
+    });
+    plan.new_join_node(false,
+        4,
+        2,
+        1,
+        0,
+        {
+            {0, DataType::VARCHAR},
+            {3, DataType::INT64}
+    });
+    plan.new_join_node(true,
+        3,
+        5,
+        0,
+        1,
+        {
+            {1, DataType::VARCHAR},
+            {0, DataType::INT64}
+    });
+    std::vector<std::vector<Data>> data1, data2, data3, data4;
+    for (int32_t i = 0; i < 2000; ++i) {
+        if (i % 7 == 0) {
+            data1.push_back({i % 300, std::monostate{}});
+        } else if (i % 50 == 1) {
+            data1.push_back({i % 300, std::string(9000 + i, static_cast<char>('a' + i % 26))});
+        } else {
+            data1.push_back({i % 300, "s" + std::to_string(i)});
+        }
+    }
+    for (int32_t i = 0; i < 300; ++i) {
+        data2.push_back({i, i % 40});
+    }
+    for (int32_t i = 0; i < 80; ++i) {
+        data3.push_back({i % 40, int64_t(i)});
+    }
+    for (int32_t i = 0; i < 80; i += 2) {
+        data4.push_back({int64_t(i)});
+    }
+    Table table1(std::move(data1), {DataType::INT32, DataType::VARCHAR});
+    Table table2(std::move(data2), {DataType::INT32, DataType::INT32});
+    Table table3(std::move(data3), {DataType::INT32, DataType::INT64});
+    Table table4(std::move(data4), {DataType::INT64});
+    plan.inputs.emplace_back(table1.to_columnar());
+    plan.inputs.emplace_back(table2.to_columnar());
+    plan.inputs.emplace_back(table3.to_columnar());
+    plan.inputs.emplace_back(table4.to_columnar());
+    plan.root = 6;
+
+    // Morsels of 7 rows start and end in the middle of pages and long strings.
+    ColumnarExecutor materialized;
+    materialized.batch_rows = 0;
+    ColumnarExecutor pipelined;
+    pipelined.batch_rows = 7;
+    auto expected        = Table::from_columnar(materialized.execute_impl(plan, plan.root));
+    auto result          = Table::from_columnar(pipelined.execute_impl(plan, plan.root));
+    REQUIRE(result.number_rows() == expected.number_rows());
+    REQUIRE(result.number_rows() > 0);
+    sort(result.table());
+    sort(expected.table());
+    REQUIRE(result.table() == expected.table());
+}
+
+TEST_CASE("Joins on one equivalence class run as a star join", "[join]") {
+    Plan plan;
+    plan.new_scan_node(0,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT64}
+    });
+    plan.new_scan_node(1,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT32}
+    });
+    plan.new_scan_node(2,
+        {
+            {0, DataType::INT32},
+            {1, DataType::VARCHAR}
+    });
+    plan.new_scan_node(3, {{0, DataType::INT32}});
+    plan.new_join_node(false,
+        0,
+        1,
+        0,
+        0,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT64},
+            {3, DataType::INT32}
+    });
+    // The second join probes with the key of the fact table and the third one
+    // with the key of the build side of the second one.
+    plan.new_join_node(false,
+        4,
+        2,
+        0,
+        0,
+        {
+            {3, DataType::INT32},
+            {1, DataType::INT64},
+            {4, DataType::VARCHAR},
+            {2, DataType::INT32}
+    });
+    plan.new_join_node(true,
+        3,
+        5,
+        0,
+        0,
+        {
+            {1, DataType::INT32},
+            {2, DataType::INT64},
+            {3, DataType::VARCHAR},
+            {4, DataType::INT32},
+            {0, DataType::INT32}
+    });
+    std::vector<std::vector<Data>> data1, data2, data3, data4;
+    for (int32_t i = 0; i < 3000; ++i) {
+        if (i % 11 == 0) {
+            data1.push_back({std::monostate{}, int64_t(i)});
+        } else {
+            data1.push_back({i % 500, int64_t(i)});
+        }
+    }
+    for (int32_t i = 0; i < 600; ++i) {
+        data2.push_back({i % 400, i});
+    }
+    for (int32_t i = 0; i < 250; ++i) {
+        data3.push_back({i * 2, "value" + std::to_string(i)});
+    }
+    for (int32_t i = 0; i < 300; ++i) {
+        data4.push_back({i % 100 * 3});
+    }
+    Table table1(std::move(data1), {DataType::INT32, DataType::INT64});
+    Table table2(std::move(data2), {DataType::INT32, DataType::INT32});
+    Table table3(std::move(data3), {DataType::INT32, DataType::VARCHAR});
+    Table table4(std::move(data4), {DataType::INT32});
+    plan.inputs.emplace_back(table1.to_columnar());
+    plan.inputs.emplace_back(table2.to_columnar());
+    plan.inputs.emplace_back(table3.to_columnar());
+    plan.inputs.emplace_back(table4.to_columnar());
+    plan.root = 6;
+
+    ColumnarExecutor materialized;
+    materialized.batch_rows = 0;
+    // Small batches flush in the middle of the matches of a driving row.
+    ColumnarExecutor star;
+    star.batch_rows = 16;
+    auto expected   = Table::from_columnar(materialized.execute_impl(plan, plan.root));
+    auto result     = Table::from_columnar(star.execute_impl(plan, plan.root));
+    REQUIRE(result.number_rows() == expected.number_rows());
+    REQUIRE(result.number_rows() > 0);
+    sort(result.table());
+    sort(expected.table());
+    REQUIRE(result.table() == expected.table());
+}
+
+TEST_CASE("Grace hash join keeps the partitions of its input", "[join]") {
+    Plan plan;
+    plan.new_scan_node(0,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT64}
+    });
+    plan.new_scan_node(1,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT32}
+    });
+    plan.new_scan_node(2,
+        {
+            {0, DataType::INT32},
+            {1, DataType::VARCHAR}
+    });
+    plan.new_join_node(true,
+        0,
+        1,
+        0,
+        0,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT64},
+            {3, DataType::INT32}
+    });
+    // The upper join builds on the lower one, on a key of the same class.
+    plan.new_join_node(true,
+        3,
+        2,
+        0,
+        0,
+        {
+            {0, DataType::INT32},
+            {4, DataType::VARCHAR},
+            {1, DataType::INT64}
+    });
+    std::vector<std::vector<Data>> data1, data2, data3;
+    for (int32_t i = 0; i < 5000; ++i) {
+        data1.push_back({i % 2000, int64_t(i)});
+    }
+    for (int32_t i = 0; i < 8000; ++i) {
+        data2.push_back({i % 2500, i});
+    }
+    for (int32_t i = 0; i < 3000; ++i) {
+        data3.push_back({i % 1500, "value" + std::to_string(i)});
+    }
+    Table table1(std::move(data1), {DataType::INT32, DataType::INT64});
+    Table table2(std::move(data2), {DataType::INT32, DataType::INT32});
+    Table table3(std::move(data3), {DataType::INT32, DataType::VARCHAR});
+    plan.inputs.emplace_back(table1.to_columnar());
+    plan.inputs.emplace_back(table2.to_columnar());
+    plan.inputs.emplace_back(table3.to_columnar());
+    plan.root = 4;
+
+    ColumnarExecutor in_memory;
+    ColumnarExecutor spilling;
+    spilling.memory_budget = 1;
+    auto expected          = Table::from_columnar(in_memory.execute_impl(plan, plan.root));
+    auto result            = Table::from_columnar(spilling.execute_impl(plan, plan.root));
+    REQUIRE(!in_memory.output_partitioning.has_value());
+    REQUIRE(spilling.output_partitioning.has_value());
+    // The upper join spills its build side along the partitions of the lower one.
+    REQUIRE(in_memory.reused_partitionings == 0);
+    REQUIRE(spilling.reused_partitionings == 1);
+
+    const auto& partitioning = spilling.output_partitioning.value();
+    size_t      num_rows     = 0;
+    for (auto rows: partitioning.partition_rows) {
+        num_rows += rows;
+    }
+    REQUIRE(partitioning.key_columns == std::vector<size_t>{0});
+    REQUIRE(num_rows == result.number_rows());
+    REQUIRE(result.number_rows() == expected.number_rows());
+    sort(result.table());
+    sort(expected.table());
+    REQUIRE(result.table() == expected.table());
+}
+
+TEST_CASE("Pipeline carries key hashes to a later join on the same key", "[join]") {
+    Plan plan;
+    plan.new_scan_node(0,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT32}
+    });
+    plan.new_scan_node(1, {{0, DataType::INT32}});
+    plan.new_scan_node(2, {{0, DataType::INT32}});
+    plan.new_scan_node(3, {{0, DataType::INT32}});
+    // The joins are on the first, the second and again the first column of the
+    // scan, the last one reuses the hashes of the first one.
+    plan.new_join_node(false,
+        0,
+        1,
+        0,
+        0,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT32}
+    });
+    plan.new_join_node(false,
+        4,
+        2,
+        1,
+        0,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT32}
+    });
+    plan.new_join_node(false,
+        5,
+        3,
+        0,
+        0,
+        {
+            {1, DataType::INT32},
+            {2, DataType::INT32},
+            {0, DataType::INT32}
+    });
+    // Build keys are spread out so that every build side gets a hash table.
+    std::vector<std::vector<Data>> data1, data2, data3, data4;
+    for (int32_t i = 0; i < 20000; ++i) {
+        if (i % 13 == 0) {
+            data1.push_back({std::monostate{}, i % 6000 * 16});
+        } else {
+            data1.push_back({i * 7 % 8000 * 16, i % 6000 * 16});
+        }
+    }
+    for (int32_t i = 0; i < 4000; ++i) {
+        data2.push_back({i * 32});
+    }
+    for (int32_t i = 0; i < 5000; ++i) {
+        data3.push_back({i * 16});
+    }
+    for (int32_t i = 0; i < 3500; ++i) {
+        data4.push_back({i * 48});
+    }
+    Table table1(std::move(data1), {DataType::INT32, DataType::INT32});
+    Table table2(std::move(data2), {DataType::INT32});
+    Table table3(std::move(data3), {DataType::INT32});
+    Table table4(std::move(data4), {DataType::INT32});
+    plan.inputs.emplace_back(table1.to_columnar());
+    plan.inputs.emplace_back(table2.to_columnar());
+    plan.inputs.emplace_back(table3.to_columnar());
+    plan.inputs.emplace_back(table4.to_columnar());
+    plan.root = 6;
+
+    ColumnarExecutor materialized;
+    materialized.batch_rows = 0;
+    ColumnarExecutor pipelined;
+    auto expected = Table::from_columnar(materialized.execute_impl(plan, plan.root));
+    auto result   = Table::from_columnar(pipelined.execute_impl(plan, plan.root));
+    // Only the last join of the pipeline probes with hashes it did not compute.
+    REQUIRE(materialized.reused_key_hashes == 0);
+    REQUIRE(pipelined.reused_key_hashes == 1);
+    REQUIRE(result.number_rows() == expected.number_rows());
+    REQUIRE(result.number_rows() > 0);
+    sort(result.table());
+    sort(expected.table());
+    REQUIRE(result.table() == expected.table());
+}
+
+TEST_CASE("Joins above a pipeline reuse the key hashes it carries", "[join]") {
+    Plan plan;
+    plan.new_scan_node(0,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT32}
+    });
+    plan.new_scan_node(1, {{0, DataType::INT32}});
+    plan.new_scan_node(2, {{0, DataType::INT32}});
+    plan.new_scan_node(3, {{0, DataType::INT32}});
+    // The two lower joins run as a pipeline that carries the hashes of the
+    // first column over to its output, the top join builds on that column.
+    plan.new_join_node(false,
+        0,
+        1,
+        0,
+        0,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT32}
+    });
+    plan.new_join_node(false,
+        4,
+        2,
+        1,
+        0,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT32}
+    });
+    plan.new_join_node(true,
+        5,
+        3,
+        0,
+        0,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT32},
+            {2, DataType::INT32}
+    });
+    std::vector<std::vector<Data>> data1, data2, data3, data4;
+    for (int32_t i = 0; i < 20000; ++i) {
+        data1.push_back({i * 7 % 8000 * 16, i % 6000 * 16});
+    }
+    for (int32_t i = 0; i < 4000; ++i) {
+        data2.push_back({i * 16});
+    }
+    for (int32_t i = 0; i < 5000; ++i) {
+        data3.push_back({i * 16});
+    }
+    for (int32_t i = 0; i < 100000; ++i) {
+        data4.push_back({i % 8000 * 16});
+    }
+    Table table1(std::move(data1), {DataType::INT32, DataType::INT32});
+    Table table2(std::move(data2), {DataType::INT32});
+    Table table3(std::move(data3), {DataType::INT32});
+    Table table4(std::move(data4), {DataType::INT32});
+    plan.inputs.emplace_back(table1.to_columnar());
+    plan.inputs.emplace_back(table2.to_columnar());
+    plan.inputs.emplace_back(table3.to_columnar());
+    plan.inputs.emplace_back(table4.to_columnar());
+    plan.root = 6;
+
+    ColumnarExecutor materialized;
+    materialized.batch_rows = 0;
+    auto expected = Table::from_columnar(materialized.execute_impl(plan, plan.root));
+    REQUIRE(materialized.reused_key_hashes == 0);
+    REQUIRE(expected.number_rows() > 0);
+    sort(expected.table());
+
+    // The top join builds its hash table from the carried hashes.
+    ColumnarExecutor in_memory;
+    auto             result = Table::from_columnar(in_memory.execute_impl(plan, plan.root));
+    REQUIRE(in_memory.reused_key_hashes == 1);
+    REQUIRE(!in_memory.output_partitioning.has_value());
+    sort(result.table());
+    REQUIRE(result.table() == expected.table());
+
+    // The pipeline fits in the budget, the top join spills and partitions its
+    // build side by the carried hashes.
+    ColumnarExecutor spilling;
+    spilling.memory_budget = 1 << 20;
+    result = Table::from_columnar(spilling.execute_impl(plan, plan.root));
+    REQUIRE(spilling.reused_key_hashes == 1);
+    REQUIRE(spilling.output_partitioning.has_value());
+    sort(result.table());
+    REQUIRE(result.table() == expected.table());
+}
+
+TEST_CASE("Streaming column inserter writes the same column", "[join]") {
+    Column cached_ints(DataType::INT32), streamed_ints(DataType::INT32);
+    Column cached_strings(DataType::VARCHAR), streamed_strings(DataType::VARCHAR);
+    ColumnInserter<int32_t>     cached_int_inserter(cached_ints);
+    ColumnInserter<int32_t>     streamed_int_inserter(streamed_ints, true);
+    ColumnInserter<std::string> cached_string_inserter(cached_strings);
+    ColumnInserter<std::string> streamed_string_inserter(streamed_strings, true);
+    // Enough rows for many pages, with nulls and a string spanning pages.
+    constexpr int32_t num_rows = 10000;
+    std::string       long_string(3 * PAGE_SIZE, 'x');
+    for (int32_t i = 0; i < num_rows; ++i) {
+        if (i % 11 == 0) {
+            cached_int_inserter.insert_null();
+            streamed_int_inserter.insert_null();
+            cached_string_inserter.insert_null();
+            streamed_string_inserter.insert_null();
+            continue;
+        }
+        std::string value = i == 5000 ? long_string : std::to_string(i);
+        cached_int_inserter.insert(i);
+        streamed_int_inserter.insert(i);
+        cached_string_inserter.insert(value);
+        streamed_string_inserter.insert(value);
+    }
+    cached_int_inserter.finalize();
+    streamed_int_inserter.finalize();
+    cached_string_inserter.finalize();
+    streamed_string_inserter.finalize();
+    REQUIRE(streamed_ints.pages.size() == cached_ints.pages.size());
+    REQUIRE(streamed_strings.pages.size() == cached_strings.pages.size());
+
+    ColumnarTable cached, streamed;
+    cached.num_rows   = num_rows;
+    streamed.num_rows = num_rows;
+    cached.columns.push_back(std::move(cached_ints));
+    cached.columns.push_back(std::move(cached_strings));
+    streamed.columns.push_back(std::move(streamed_ints));
+    streamed.columns.push_back(std::move(streamed_strings));
+    REQUIRE(Table::from_columnar(streamed).table() == Table::from_columnar(cached).table());
+}
+
+TEST_CASE("Probe throughput with streaming output pages", "[.][benchmark]") {
+    // Random lookups into a table that fills half of the last level cache
+    // stand in for the probe, every lookup appends one value to the output.
+    // Cached output pages evict the table, streamed ones do not.
+    constexpr size_t table_size = SPC__LEVEL3_CACHE_SIZE / 2 / sizeof(int64_t);
+    constexpr size_t num_rows   = 4 * SPC__LEVEL3_CACHE_SIZE / sizeof(int64_t);
+    std::vector<int64_t> table(table_size);
+    for (size_t i = 0; i < table_size; ++i) {
+        table[i] = static_cast<int64_t>(i);
+    }
+
+    auto probe = [&](bool streaming) {
+        Column                  column(DataType::INT64);
+        ColumnInserter<int64_t> inserter(column, streaming);
+        uint64_t                state = 0x9e3779b97f4a7c15;
+        for (size_t i = 0; i < num_rows; ++i) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            inserter.insert(table[(state >> 32) % table_size]);
+        }
+        inserter.finalize();
+        return column.pages.size();
+    };
+
+    BENCHMARK("Cached output pages") {
+        return probe(false);
+    };
+    BENCHMARK("Streamed output pages") {
+        return probe(true);
+    };
+}
+
+// Writes `contents` to a file in the temporary directory and returns its path.
+static std::filesystem::path write_temp_file(const std::string& name,
+    const std::string&                                          contents) {
+    auto path = std::filesystem::temp_directory_path() / name;
+    std::ofstream(path) << contents;
+    return path;
+}
+
+TEST_CASE("Table cache stays within its capacity", "[table]") {
+    std::vector<Attribute> attributes{
+        {DataType::INT32,   "id"  },
+        {DataType::VARCHAR, "name"}
+    };
+    std::string contents;
+    for (int32_t i = 0; i < 5000; ++i) {
+        contents += fmt::format("{},name{}\n", i, i % 100);
+    }
+    std::vector<std::filesystem::path> paths;
+    for (int i = 0; i < 4; ++i) {
+        paths.push_back(write_temp_file(fmt::format("table_cache_{}.csv", i), contents));
+    }
+    auto saved_capacity = Table::cache_capacity;
+
+    // Measures the cached size of a table and of its unfiltered result.
+    Table::cache_capacity = std::numeric_limits<size_t>::max();
+    size_t before         = Table::cached_bytes();
+    auto   expected    = Table::from_columnar(Table::from_csv(attributes, paths[0], nullptr));
+    size_t table_bytes = Table::cached_bytes() - before;
+    REQUIRE(table_bytes > 0);
+
+    // Two of the tables fit, the third one evicts the least recently used.
+    Table::cache_capacity = table_bytes * 5 / 2;
+    for (size_t i = 0; i < 3; ++i) {
+        auto table = Table::from_columnar(Table::from_csv(attributes, paths[i], nullptr));
+        REQUIRE(Table::cached_bytes() <= Table::cache_capacity);
+        REQUIRE(table.table() == expected.table());
+    }
+
+    // A table larger than the whole cache is loaded without being cached.
+    Table::cache_capacity = table_bytes / 4;
+    auto table = Table::from_columnar(Table::from_csv(attributes, paths[3], nullptr));
+    REQUIRE(Table::cached_bytes() <= Table::cache_capacity);
+    REQUIRE(table.table() == expected.table());
+
+    Table::cache_capacity = saved_capacity;
+    for (const auto& path: paths) {
+        std::filesystem::remove(path);
+    }
+}
+
+TEST_CASE("Cached tables are not charged to the memory budget", "[table]") {
+    std::vector<Attribute> wide_attributes{
+        {DataType::INT32,   "id"  },
+        {DataType::VARCHAR, "text"}
+    };
+    std::vector<Attribute> attributes{
+        {DataType::INT32, "id"   },
+        {DataType::INT64, "value"}
+    };
+    std::string wide_contents, contents;
+    for (int32_t i = 0; i < 50000; ++i) {
+        wide_contents += fmt::format("{},{:040}\n", i, i);
+    }
+    for (int32_t i = 0; i < 5000; ++i) {
+        contents += fmt::format("{},{}\n", i % 4000, i);
+    }
+    auto wide_path = write_temp_file("cache_budget_wide.csv", wide_contents);
+    auto path      = write_temp_file("cache_budget.csv", contents);
+    Table::from_csv(wide_attributes, wide_path, nullptr);
+
+    Plan plan;
+    plan.new_scan_node(0,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT64}
+    });
+    plan.new_scan_node(1,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT64}
+    });
+    plan.new_join_node(true,
+        0,
+        1,
+        0,
+        0,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT64},
+            {3, DataType::INT64}
+    });
+    plan.inputs.emplace_back(Table::from_csv(attributes, path, nullptr));
+    plan.inputs.emplace_back(Table::from_csv(attributes, path, nullptr));
+    plan.root = 2;
+
+    // The cache alone exceeds the budget, the join still runs in memory.
+    ColumnarExecutor executor;
+    executor.memory_budget = Table::cached_bytes() / 2;
+    executor.charge_inputs(plan);
+    size_t input_bytes = executor.memory_in_use;
+    REQUIRE(input_bytes < executor.memory_budget);
+    auto result = executor.execute_impl(plan, plan.root);
+    REQUIRE(result.num_rows == 7000);
+    REQUIRE(!executor.output_partitioning.has_value());
+    REQUIRE(executor.memory_in_use == input_bytes);
+
+    std::filesystem::remove(wide_path);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Projected loads count rows without payload columns", "[table]") {
+    std::vector<Attribute> attributes{
+        {DataType::INT32,   "id"   },
+        {DataType::INT64,   "value"},
+        {DataType::VARCHAR, "name" }
+    };
+    std::string contents;
+    for (int32_t i = 0; i < 5000; ++i) {
+        contents += fmt::format("{},{},name{}\n", i, i * 3, i % 100);
+    }
+    auto path = write_temp_file("projected_load.csv", contents);
+
+    // Filtered loads, with one projected column and with none at all.
+    Comparison          filter(0, Comparison::LT, int64_t(1000));
+    std::vector<size_t> id_only{0}, no_columns;
+    auto                table = Table::from_csv(attributes, path, &filter, &id_only);
+    REQUIRE(table.num_rows == 1000);
+    REQUIRE(!table.columns[0].pages.empty());
+    REQUIRE(table.columns[1].pages.empty());
+    REQUIRE(table.columns[2].pages.empty());
+    auto rows = Table::from_columnar(table);
+    for (int32_t i = 0; i < 1000; ++i) {
+        REQUIRE(rows.table()[i] == std::vector<Data>{i, std::monostate{}, std::monostate{}});
+    }
+    table = Table::from_csv(attributes, path, &filter, &no_columns);
+    REQUIRE(table.num_rows == 1000);
+    for (const auto& column: table.columns) {
+        REQUIRE(column.pages.empty());
+    }
+
+    // Unfiltered loads are counted the same way.
+    table = Table::from_csv(attributes, path, nullptr, &no_columns);
+    REQUIRE(table.num_rows == 5000);
+    for (const auto& column: table.columns) {
+        REQUIRE(column.pages.empty());
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Result cache hits copy only the projected columns", "[table]") {
+    std::vector<Attribute> attributes{
+        {DataType::INT32,   "id"   },
+        {DataType::INT64,   "value"},
+        {DataType::VARCHAR, "name" }
+    };
+    std::string contents;
+    for (int32_t i = 0; i < 5000; ++i) {
+        contents += fmt::format("{},{},name{}\n", i, i * 3, i % 100);
+    }
+    auto path = write_temp_file("projected_cache_hit.csv", contents);
+
+    // The first load fills the result cache with every column.
+    auto expected = Table::from_columnar(Table::from_csv(attributes, path, nullptr));
+    REQUIRE(expected.number_rows() == 5000);
+    size_t cached_bytes = Table::cached_bytes();
+
+    std::vector<size_t> value_only{1}, no_columns;
+    auto                table = Table::from_csv(attributes, path, nullptr, &value_only);
+    REQUIRE(Table::cached_bytes() == cached_bytes);
+    REQUIRE(table.num_rows == 5000);
+    REQUIRE(table.columns[0].pages.empty());
+    REQUIRE(!table.columns[1].pages.empty());
+    REQUIRE(table.columns[2].pages.empty());
+    auto rows = Table::from_columnar(table);
+    for (size_t i = 0; i < 5000; ++i) {
+        std::vector<Data> row{std::monostate{}, expected.table()[i][1], std::monostate{}};
+        REQUIRE(rows.table()[i] == row);
+    }
+    table = Table::from_csv(attributes, path, nullptr, &no_columns);
+    REQUIRE(table.num_rows == 5000);
+    for (const auto& column: table.columns) {
+        REQUIRE(column.pages.empty());
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Scans of one loaded table hand its pages back", "[table]") {
+    std::vector<Attribute> attributes{
+        {DataType::INT32, "id"   },
+        {DataType::INT64, "value"}
+    };
+    std::string contents, other_contents;
+    for (int32_t i = 0; i < 3000; ++i) {
+        contents += fmt::format("{},{}\n", i, i * 2);
+    }
+    for (int32_t i = 0; i < 2000; ++i) {
+        other_contents += fmt::format("{},{}\n", i, i + 7);
+    }
+    auto path       = write_temp_file("borrowed_pages.csv", contents);
+    auto other_path = write_temp_file("borrowed_pages_other.csv", other_contents);
+
+    // Base table 0 is scanned twice and feeds both joins.
+    Plan plan;
+    plan.new_scan_node(0,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT64}
+    });
+    plan.new_scan_node(1,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT64}
+    });
+    plan.new_scan_node(0,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT64}
+    });
+    plan.new_join_node(true,
+        0,
+        1,
+        0,
+        0,
+        {
+            {0, DataType::INT32},
+            {1, DataType::INT64},
+            {3, DataType::INT64}
+    });
+    plan.new_join_node(false,
+        3,
+        2,
+        0,
+        0,
+        {
+            {0, DataType::INT32},
+            {2, DataType::INT64},
+            {4, DataType::INT64}
+    });
+    plan.inputs.emplace_back(Table::from_csv(attributes, path, nullptr));
+    plan.inputs.emplace_back(Table::from_csv(attributes, other_path, nullptr));
+    plan.root = 4;
+    auto input = Table::from_columnar(plan.inputs[0]);
+
+    std::vector<std::vector<Data>> expected;
+    for (int32_t i = 0; i < 2000; ++i) {
+        expected.push_back({i, int64_t(i + 7), int64_t(i * 2)});
+    }
+    for (size_t batch_rows: {size_t(0), ColumnarExecutor{}.batch_rows}) {
+        ColumnarExecutor executor;
+        executor.batch_rows = batch_rows;
+        auto result = Table::from_columnar(executor.execute_impl(plan, plan.root));
+        sort(result.table());
+        REQUIRE(result.table() == expected);
+        REQUIRE(Table::from_columnar(plan.inputs[0]).table() == input.table());
+    }
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(other_path);
+}
+
+// The branch-free block kernel at every supported SIMD level and the branching one.
+static std::vector<BlockKernel> block_kernel_variants() {
+    std::vector<BlockKernel> ret;
+    for (int level = 0; level <= static_cast<int>(simd_level()); ++level) {
+        ret.emplace_back(static_cast<SimdLevel>(level));
+    }
+    ret.emplace_back(SimdLevel::Scalar, true);
+    return ret;
+}
+
+TEST_CASE("Filter kernels agree at every SIMD level", "[filter]") {
+    InnerColumn<int64_t> column;
+    for (int64_t i = 0; i < 1003; ++i) {
+        if (i % 7 == 3) {
+            column.push_back_null();
+        } else {
+            column.push_back(i % 11 - 5);
+        }
+    }
+    auto reference = [&column](Comparison::Op op, int64_t rhs) {
+        std::vector<uint8_t> ret(column.bitmap.size());
+        for (size_t i = 0; i < column.data.size(); ++i) {
+            if (not column.is_not_null(i)) {
+                continue;
+            }
+            Comparison comparison(0, op, rhs);
+            if (comparison.eval(std::vector<Data>{column.get(i)})) {
+                ret[i / 8] |= 1 << (i % 8);
+            }
+        }
+        return ret;
+    };
+    for (auto op: {Comparison::EQ,
+             Comparison::NEQ,
+             Comparison::LT,
+             Comparison::GT,
+             Comparison::LEQ,
+             Comparison::GEQ}) {
+        auto expected = reference(op, 2);
+        REQUIRE(Comparison(0, op, int64_t(2)).eval({&column}) == expected);
+        for (auto kernel: block_kernel_variants()) {
+            // Start one byte in so the vector loops run on unaligned data with a tail.
+            std::vector<uint8_t> output(column.bitmap.size());
+            compare_kernel<int64_t>(op,
+                kernel,
+                column.data.data() + 8,
+                column.bitmap.data() + 1,
+                output.data() + 1,
+                column.data.size() - 8,
+                2);
+            output[0] = expected[0];
+            REQUIRE(output == expected);
+        }
+    }
+}
+
+TEST_CASE("Predicate trees are evaluated block by block", "[filter]") {
+    // Spans two full filter blocks and a partial one.
+    size_t                         num_rows = FILTER_BLOCK_BYTES * 8 * 2 + 1001;
+    InnerColumn<int32_t>           ints;
+    InnerColumn<double>            doubles;
+    InnerColumn<std::string>       strings;
+    std::vector<std::vector<Data>> records;
+    for (size_t i = 0; i < num_rows; ++i) {
+        std::vector<Data> record;
+        if (i % 13 == 5) {
+            ints.push_back_null();
+            record.emplace_back(std::monostate{});
+        } else {
+            ints.push_back(static_cast<int32_t>(i % 100));
+            record.emplace_back(static_cast<int32_t>(i % 100));
+        }
+        doubles.push_back(static_cast<double>(i % 7) / 2);
+        record.emplace_back(static_cast<double>(i % 7) / 2);
+        if (i % 17 == 2) {
+            strings.push_back_null();
+            record.emplace_back(std::monostate{});
+        } else {
+            auto value = fmt::format("row{}", i % 50);
+            strings.push_back(value);
+            record.emplace_back(std::move(value));
+        }
+        records.emplace_back(std::move(record));
+    }
+    std::vector<const InnerColumnBase*> table{&ints, &doubles, &strings};
+
+    // (ints < 40 OR strings LIKE 'row1%') AND NOT (doubles >= 2.5) AND strings IS NOT NULL
+    auto filter = LogicalOperation::makeAnd(
+        LogicalOperation::makeAnd(
+            LogicalOperation::makeOr(
+                std::make_unique<Comparison>(0, Comparison::LT, int64_t(40)),
+                std::make_unique<Comparison>(2, Comparison::LIKE, std::string("row1%"))),
+            LogicalOperation::makeNot(
+                std::make_unique<Comparison>(1, Comparison::GEQ, 2.5))),
+        std::make_unique<Comparison>(2, Comparison::IS_NOT_NULL, std::monostate{}));
+
+    auto result = filter->eval(table);
+    REQUIRE(result.size() == (num_rows + 7) / 8);
+    for (size_t i = 0; i < num_rows; ++i) {
+        bool selected = result[i / 8] & (1 << (i % 8));
+        REQUIRE(selected == filter->eval(records[i]));
+    }
+    REQUIRE((result.back() >> (num_rows % 8)) == 0);
+}
+
+TEST_CASE("IN lists match like a chain of equalities", "[filter]") {
+    size_t                   num_rows = 5000;
+    InnerColumn<int32_t>     ints;
+    InnerColumn<int64_t>     longs;
+    InnerColumn<std::string> strings;
+    for (size_t i = 0; i < num_rows; ++i) {
+        if (i % 11 == 4) {
+            ints.push_back_null();
+            longs.push_back_null();
+            strings.push_back_null();
+        } else {
+            ints.push_back(static_cast<int32_t>(i % 37));
+            longs.push_back(static_cast<int64_t>(i % 101) * 1000000007);
+            strings.push_back(fmt::format("kind{}", i % 23));
+        }
+    }
+    std::vector<const InnerColumnBase*> table{&ints, &longs, &strings};
+
+    auto check = [&table](size_t column, std::vector<Literal> values) {
+        std::unique_ptr<Statement> chain;
+        for (auto& value: values) {
+            auto equal = std::make_unique<Comparison>(column, Comparison::EQ, value);
+            chain      = chain ? LogicalOperation::makeOr(std::move(chain), std::move(equal))
+                               : std::unique_ptr<Statement>(std::move(equal));
+        }
+        InList in_list(column, std::move(values));
+        REQUIRE(in_list.eval(table) == chain->eval(table));
+    };
+    // Few values are compared in vector registers, more are binary searched.
+    check(0, {int64_t(3), int64_t(30), int64_t(3), int64_t(-1)});
+    check(0, {int64_t(1), int64_t(2), int64_t(5), int64_t(8), int64_t(13), int64_t(21),
+                 int64_t(34), int64_t(55), int64_t(89), int64_t(36)});
+    check(1, {int64_t(7) * 1000000007, int64_t(100) * 1000000007});
+    std::vector<Literal> many;
+    for (int64_t i = 0; i < 40; i += 3) {
+        many.emplace_back(i * 1000000007);
+    }
+    check(1, many);
+    check(2, {std::string("kind1"), std::string("kind22"), std::string("kind99")});
+
+    InList               in_list(0, {int64_t(3), int64_t(30), int64_t(36)});
+    std::vector<uint8_t> expected = in_list.eval(table);
+    for (auto kernel: block_kernel_variants()) {
+        std::vector<uint8_t> output(expected.size());
+        in_list_kernel<int32_t>(kernel,
+            ints.data.data(),
+            ints.bitmap.data(),
+            output.data(),
+            num_rows,
+            in_list.int32_values.data(),
+            in_list.int32_values.size());
+        REQUIRE(output == expected);
+    }
+}
+
+TEST_CASE("LIKE patterns without '_' match without RE2", "[filter]") {
+    REQUIRE(LikePattern("Tom Hanks").kind == LikePattern::EXACT);
+    REQUIRE(LikePattern("USA:%").kind == LikePattern::PREFIX);
+    REQUIRE(LikePattern("%(voice)").kind == LikePattern::SUFFIX);
+    REQUIRE(LikePattern("%Downey%").kind == LikePattern::CONTAINS);
+    REQUIRE(LikePattern("%Downey%Robert%").kind == LikePattern::SEGMENTS);
+    REQUIRE(LikePattern("B%a%").kind == LikePattern::SEGMENTS);
+    REQUIRE(LikePattern("%(200_)%").kind == LikePattern::REGEX);
+
+    std::vector<std::string> patterns{"", "%", "%%", "abc", "a%", "%c", "%b%", "a%c", "%a%b%",
+        "ab%ab", "%ab%ab%", "a%%b", "%aba", "aba%", "%a_c%", "_b%"};
+    std::vector<std::string> strings{"", "a", "b", "abc", "ab", "aab", "abab", "ababab",
+        "aba", "cab", "acbab", "abcab", "xaby", "a.c", "a%c"};
+    for (auto& pattern: patterns) {
+        LikePattern like(pattern);
+        for (auto& str: strings) {
+            REQUIRE(like.match(str) == Comparison::like_match(str, pattern));
+        }
+    }
+
+    InnerColumn<std::string> column;
+    for (size_t i = 0; i < 100; ++i) {
+        if (i % 9 == 0) {
+            column.push_back_null();
+        } else {
+            column.push_back(fmt::format("{}:{}", i % 2 ? "USA" : "Germany", i));
+        }
+    }
+    auto like     = Comparison(0, Comparison::LIKE, std::string("USA:%1")).eval({&column});
+    auto not_like = Comparison(0, Comparison::NOT_LIKE, std::string("USA:%1")).eval({&column});
+    for (size_t i = 0; i < 100; ++i) {
+        bool non_null = i % 9 != 0;
+        bool matches  = i % 2 == 1 and i % 10 == 1;
+        REQUIRE(bool(like[i / 8] & (1 << (i % 8))) == (non_null and matches));
+        REQUIRE(bool(not_like[i / 8] & (1 << (i % 8))) == (non_null and not matches));
+    }
+}
+
+TEST_CASE("Dictionary encoded strings filter like plain ones", "[filter]") {
+    std::vector<std::string> kinds{"movie", "tv series", "tv movie", "video movie", "episode"};
+    InnerColumn<std::string> plain;
+    InnerColumn<std::string> encoded;
+    InnerColumn<std::string> unique;
+    for (size_t i = 0; i < 20011; ++i) {
+        if (i % 19 == 7) {
+            plain.push_back_null();
+            encoded.push_back_null();
+        } else {
+            plain.push_back(kinds[i * 7 % kinds.size()]);
+            encoded.push_back(kinds[i * 7 % kinds.size()]);
+        }
+        unique.push_back(fmt::format("name{}", i));
+    }
+    encoded.encode();
+    unique.encode();
+    REQUIRE(encoded.encoded());
+    REQUIRE(encoded.dictionary.size() == kinds.size());
+    REQUIRE(not unique.encoded());
+    for (size_t i = 0; i < encoded.size(); ++i) {
+        if (encoded.is_not_null(i)) {
+            REQUIRE(encoded.dictionary[encoded.codes[i]] == encoded.get(i));
+        }
+    }
+
+    std::vector<std::unique_ptr<Statement>> filters;
+    filters.emplace_back(std::make_unique<Comparison>(0, Comparison::EQ, std::string("movie")));
+    filters.emplace_back(
+        std::make_unique<Comparison>(0, Comparison::NEQ, std::string("movie")));
+    filters.emplace_back(std::make_unique<Comparison>(0, Comparison::LT, std::string("tv")));
+    filters.emplace_back(
+        std::make_unique<Comparison>(0, Comparison::LIKE, std::string("%movie")));
+    filters.emplace_back(
+        std::make_unique<Comparison>(0, Comparison::NOT_LIKE, std::string("tv%")));
+    filters.emplace_back(
+        std::make_unique<Comparison>(0, Comparison::IS_NULL, std::monostate{}));
+    filters.emplace_back(std::make_unique<InList>(0,
+        std::vector<Literal>{std::string("episode"), std::string("tv movie")}));
+    filters.emplace_back(LogicalOperation::makeNot(
+        std::make_unique<Comparison>(0, Comparison::LIKE, std::string("%v%"))));
+    for (auto& filter: filters) {
+        REQUIRE(filter->eval({&encoded}) == filter->eval({&plain}));
+    }
+
+    std::vector<uint8_t> matches{0, 1, 0, 1, 1, 0, 0, 0};
+    std::vector<uint8_t> expected(encoded.bitmap.size());
+    for (size_t i = 0; i < encoded.size(); ++i) {
+        if (encoded.is_not_null(i) and matches[encoded.codes[i]]) {
+            expected[i / 8] |= 1 << (i % 8);
+        }
+    }
+    for (auto kernel: block_kernel_variants()) {
+        std::vector<uint8_t> output(expected.size());
+        code_lookup_kernel(kernel,
+            encoded.codes.data(),
+            encoded.bitmap.data(),
+            output.data(),
+            encoded.size(),
+            matches.data());
+        REQUIRE(output == expected);
+    }
+}
+
+TEST_CASE("Plain string filters have branching and branch-free kernels", "[filter]") {
+    // Four filter blocks, enough for the bandit to try both variants.
+    size_t                   num_rows = FILTER_BLOCK_BYTES * 8 * 4 - 5;
+    InnerColumn<std::string> names;
+    std::vector<uint32_t>    rows;
+    for (size_t i = 0; i < num_rows; ++i) {
+        if (i % 11 == 4) {
+            names.push_back_null();
+        } else {
+            names.push_back(fmt::format("name{}", i % 300));
+        }
+        if (i % 3 != 0) {
+            rows.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    REQUIRE(not names.encoded());
+
+    std::vector<std::unique_ptr<Statement>> filters;
+    filters.emplace_back(
+        std::make_unique<Comparison>(0, Comparison::EQ, std::string("name12")));
+    filters.emplace_back(std::make_unique<Comparison>(0, Comparison::LT, std::string("name2")));
+    filters.emplace_back(std::make_unique<Comparison>(0, Comparison::LIKE, std::string("%1%")));
+    filters.emplace_back(
+        std::make_unique<Comparison>(0, Comparison::NOT_LIKE, std::string("name2%")));
+    filters.emplace_back(std::make_unique<InList>(0,
+        std::vector<Literal>{std::string("name7"), std::string("name77")}));
+    filters.emplace_back(LogicalOperation::makeOr(
+        std::make_unique<Comparison>(0, Comparison::LIKE, std::string("%9")),
+        std::make_unique<Comparison>(0, Comparison::LIKE, std::string("name3%"))));
+    std::vector<const InnerColumnBase*> table{&names};
+    for (auto& filter: filters) {
+        std::vector<uint8_t>  expected(names.bitmap.size());
+        std::vector<uint32_t> expected_rows;
+        for (size_t i = 0; i < num_rows; ++i) {
+            Data value = std::monostate{};
+            if (names.is_not_null(i)) {
+                value = std::string(names.get(i));
+            }
+            if (filter->eval(std::vector<Data>{value})) {
+                expected[i / 8] |= 1 << (i % 8);
+                if (i % 3 != 0) {
+                    expected_rows.push_back(static_cast<uint32_t>(i));
+                }
+            }
+        }
+        REQUIRE(filter->eval(table) == expected);
+
+        // Each block and selection kernel on its own.
+        auto matches = [&filter](std::string_view value) {
+            return filter->eval(std::vector<Data>{std::string(value)});
+        };
+        for (bool branching: {false, true}) {
+            std::vector<uint8_t> output(expected.size());
+            BlockKernel          kernel(SimdLevel::Scalar, branching);
+            names.filter_block(0, output.size(), output.data(), kernel, matches);
+            REQUIRE(output == expected);
+        }
+        for (auto kernel: {SelectionKernel::BranchFree, SelectionKernel::Branching}) {
+            std::vector<uint32_t> output(rows.size());
+            size_t num_selected = names.filter_selection(rows.data(),
+                rows.size(),
+                output.data(),
+                kernel,
+                matches);
+            output.resize(num_selected);
+            REQUIRE(output == expected_rows);
+        }
+    }
+
+    // The bandit picks between the two block kernels.
+    Comparison like(0, Comparison::LIKE, std::string("%1%"));
+    like.eval(table);
+    REQUIRE(like.block_kernels.num_variants == 2);
+    REQUIRE(like.block_kernels.uses[0] > 0);
+    REQUIRE(like.block_kernels.uses[1] > 0);
+    std::vector<uint32_t> selected(rows.size());
+    like.eval_selection(table, rows.data(), rows.size(), selected.data());
+    REQUIRE(like.selection_kernels.uses[0] + like.selection_kernels.uses[1] == 1);
+}
+
+TEST_CASE("OR'ed LIKEs on one column are matched in one pass", "[filter]") {
+    InnerColumn<std::string> names;
+    InnerColumn<std::string> infos;
+    for (size_t i = 0; i < 3000; ++i) {
+        if (i % 23 == 1) {
+            names.push_back_null();
+        } else {
+            names.push_back(fmt::format("{}, {} {}",
+                i % 3 ? "Downey" : "Stiller",
+                i % 5 ? "Robert" : "Ben",
+                i % 200));
+        }
+        infos.push_back(fmt::format("{}:{}", i % 2 ? "USA" : "America", i % 7));
+    }
+    std::vector<const InnerColumnBase*> table{&names, &infos};
+
+    auto like = [](size_t column, Comparison::Op op, const char* pattern) {
+        return std::make_unique<Comparison>(column, op, std::string(pattern));
+    };
+    auto merged = LogicalOperation::makeOr(
+        LogicalOperation::makeOr(
+            LogicalOperation::makeOr(like(0, Comparison::LIKE, "%Downey%Robert%"),
+                like(0, Comparison::LIKE, "Stiller, B_n 1%")),
+            like(0, Comparison::NOT_LIKE, "%1%")),
+        like(0, Comparison::LIKE, "%Ben 42"));
+    auto* any = dynamic_cast<LikeAny*>(merged.get());
+    REQUIRE(any != nullptr);
+    REQUIRE(any->terms.size() == 4);
+    REQUIRE(any->patterns.size() == 2);
+    REQUIRE(any->negated_patterns.size() == 1);
+    REQUIRE(any->regex_set != nullptr);
+
+    // The same predicates as a plain OR tree.
+    auto plain     = std::make_unique<LogicalOperation>();
+    plain->op_type = LogicalOperation::OR;
+    for (auto& term: any->terms) {
+        plain->children.push_back(
+            std::make_unique<Comparison>(term->column, term->op, term->value));
+    }
+    REQUIRE(merged->eval(table) == plain->eval(table));
+    for (size_t i = 0; i < names.size(); ++i) {
+        std::vector<Data> record{std::monostate{}, std::string(infos.get(i))};
+        if (names.is_not_null(i)) {
+            record[0] = std::string(names.get(i));
+        }
+        REQUIRE(merged->eval(record) == plain->eval(record));
+    }
+
+    auto other_column = LogicalOperation::makeOr(like(0, Comparison::LIKE, "%Ben%"),
+        like(1, Comparison::LIKE, "USA:%"));
+    REQUIRE(dynamic_cast<LikeAny*>(other_column.get()) == nullptr);
+
+    infos.encode();
+    auto countries = LogicalOperation::makeOr(like(1, Comparison::LIKE, "USA:%"),
+        like(1, Comparison::LIKE, "America:_"));
+    auto selected = countries->eval(table);
+    for (size_t i = 0; i < infos.size(); ++i) {
+        REQUIRE(bool(selected[i / 8] & (1 << (i % 8))));
+    }
+}
+
+TEST_CASE("Sparse conjunctions are finished on selection vectors", "[filter]") {
+    size_t                         num_rows = FILTER_BLOCK_BYTES * 8 + 3005;
+    InnerColumn<int32_t>           ints;
+    InnerColumn<int64_t>           longs;
+    InnerColumn<std::string>       strings;
+    std::vector<std::vector<Data>> records;
+    for (size_t i = 0; i < num_rows; ++i) {
+        std::vector<Data> record;
+        if (i % 29 == 3) {
+            ints.push_back_null();
+            record.emplace_back(std::monostate{});
+        } else {
+            ints.push_back(static_cast<int32_t>(i % 97));
+            record.emplace_back(static_cast<int32_t>(i % 97));
+        }
+        if (i % 31 == 7) {
+            longs.push_back_null();
+            record.emplace_back(std::monostate{});
+        } else {
+            longs.push_back(static_cast<int64_t>(i % 11));
+            record.emplace_back(static_cast<int64_t>(i % 11));
+        }
+        auto value = fmt::format("row{}", i % 40);
+        strings.push_back(value);
+        record.emplace_back(std::move(value));
+        records.emplace_back(std::move(record));
+    }
+    std::vector<const InnerColumnBase*> table{&ints, &longs, &strings};
+
+    auto check = [&](const Statement& filter) {
+        auto result = filter.eval(table);
+        for (size_t i = 0; i < num_rows; ++i) {
+            bool selected = result[i / 8] & (1 << (i % 8));
+            REQUIRE(selected == filter.eval(records[i]));
+        }
+        REQUIRE((result.back() >> (num_rows % 8)) == 0);
+    };
+
+    // NOT (ints >= 3) AND (strings LIKE 'row1%' OR longs IN (2, 5)) AND NOT strings = 'row13'
+    //   AND longs IS NOT NULL
+    auto sparse = LogicalOperation::makeAnd(
+        LogicalOperation::makeAnd(
+            LogicalOperation::makeAnd(
+                LogicalOperation::makeNot(
+                    std::make_unique<Comparison>(0, Comparison::GEQ, int64_t(3))),
+                LogicalOperation::makeOr(
+                    std::make_unique<Comparison>(2, Comparison::LIKE, std::string("row1%")),
+                    std::make_unique<InList>(1,
+                        std::vector<Literal>{int64_t(2), int64_t(5)}))),
+            LogicalOperation::makeNot(
+                std::make_unique<Comparison>(2, Comparison::EQ, std::string("row13")))),
+        std::make_unique<Comparison>(1, Comparison::IS_NOT_NULL, std::monostate{}));
+    REQUIRE(sparse->children.size() == 4);
+    check(*sparse);
+
+    // Starts on bitmaps and switches once ints < 5 leaves few rows.
+    auto dense = LogicalOperation::makeAnd(
+        LogicalOperation::makeAnd(std::make_unique<Comparison>(0, Comparison::LT, int64_t(90)),
+            std::make_unique<Comparison>(0, Comparison::LT, int64_t(5))),
+        std::make_unique<Comparison>(2, Comparison::LIKE, std::string("%w3%")));
+    check(*dense);
+
+    strings.encode();
+    REQUIRE(strings.encoded());
+    check(*sparse);
+    check(*dense);
+}
+
+TEST_CASE("Conjunction terms are ordered by measured cost and selectivity", "[filter]") {
+    size_t                   num_rows = FILTER_BLOCK_BYTES * 8 * 4;
+    InnerColumn<int32_t>     ints;
+    InnerColumn<std::string> strings;
+    for (size_t i = 0; i < num_rows; ++i) {
+        ints.push_back(static_cast<int32_t>(i % 1000));
+        strings.push_back(fmt::format("row{}", i));
+    }
+    std::vector<const InnerColumnBase*> table{&ints, &strings};
+
+    // The LIKE keeps every row, so it is run after the equality once that was measured.
+    auto filter = LogicalOperation::makeAnd(
+        std::make_unique<Comparison>(1, Comparison::LIKE, std::string("%ow%")),
+        std::make_unique<Comparison>(0, Comparison::EQ, int64_t(7)));
+    filter->prepare(table);
+    REQUIRE(filter->ranked_children() == std::vector<size_t>{1, 0});
+
+    auto result = filter->eval(table);
+    for (size_t i = 0; i < num_rows; ++i) {
+        REQUIRE(bool(result[i / 8] & (1 << (i % 8))) == (i % 1000 == 7));
+    }
+    REQUIRE(filter->stats[1].rows_in == num_rows);
+    REQUIRE(filter->stats[1].rows_out == num_rows / 1000 + 1);
+    REQUIRE(filter->stats[0].rows_in < num_rows / 100);
+    REQUIRE(filter->ranked_children() == std::vector<size_t>{1, 0});
+}
+
+TEST_CASE("Kernel variants are picked per block by a bandit", "[filter]") {
+    KernelBandit bandit;
+    bandit.reset({"slow", "fast"});
+    std::vector<size_t> picks(2);
+    for (size_t call = 0; call < 32 * KernelBandit::EXPLORE_PERIOD; ++call) {
+        size_t variant = bandit.choose();
+        bandit.record(variant, variant == 0 ? 4000 : 1000, 1000);
+        ++picks[variant];
+    }
+    // Tried during the warmup and then once per exploration period.
+    REQUIRE(picks[0] == KernelBandit::WARMUP_CALLS + 31);
+    REQUIRE(bandit.summary() == fmt::format("slow x{} 4.00 c/row, fast x{} 1.00 c/row",
+                                    picks[0],
+                                    picks[1]));
+
+    InnerColumn<int64_t>  column;
+    std::vector<uint32_t> rows;
+    for (int64_t i = 0; i < 5000; ++i) {
+        if (i % 9 == 4) {
+            column.push_back_null();
+        } else {
+            column.push_back(i % 100);
+        }
+        rows.push_back(static_cast<uint32_t>(i));
+    }
+    for (auto op: {Comparison::LT, Comparison::NEQ, Comparison::GEQ}) {
+        std::vector<uint32_t> branch_free(rows.size());
+        std::vector<uint32_t> branching(rows.size());
+        size_t                num_branch_free = column.compare_selection(op,
+            3,
+            rows.data(),
+            rows.size(),
+            branch_free.data(),
+            SelectionKernel::BranchFree);
+        size_t num_branching = column.compare_selection(op,
+            3,
+            rows.data(),
+            rows.size(),
+            branching.data(),
+            SelectionKernel::Branching);
+        REQUIRE(num_branch_free == num_branching);
+        branch_free.resize(num_branch_free);
+        branching.resize(num_branching);
+        REQUIRE(branch_free == branching);
+    }
+
+    std::vector<const InnerColumnBase*> table{&column};
+    Comparison                          filter(0, Comparison::LT, int64_t(10));
+    filter.eval(table);
+    // Two SIMD levels, or the scalar one, and the branching kernel.
+    REQUIRE(filter.block_kernels.num_variants == (simd_level() == SimdLevel::Scalar ? 2 : 3));
+    REQUIRE(filter.block_kernels.uses[0] + filter.block_kernels.uses[1] == 1);
+    REQUIRE(filter.kernel_report(0).find("0 < 10: blocks ") == 0);
+}
+
+TEST_CASE("Filter thread pool runs nested and asynchronous jobs", "[filter]") {
+    for (unsigned num_threads: {0u, 3u}) {
+        FilterThreadPool              pool(num_threads);
+        std::vector<std::atomic<int>> hits(10007);
+        pool.run(
+            [&hits](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    hits[i].fetch_add(1);
+                }
+            },
+            hits.size());
+        for (auto& hit: hits) {
+            REQUIRE(hit == 1);
+        }
+
+        std::atomic<size_t> inner{0};
+        pool.run(
+            [&pool, &inner](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    pool.run([&inner](size_t begin, size_t end) { inner += end - begin; }, 100);
+                }
+            },
+            20);
+        REQUIRE(inner == 2000);
+
+        std::atomic<size_t> sum{0};
+        auto                handle = pool.submit(
+            [&sum](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    sum += i;
+                }
+            },
+            1000);
+        pool.wait(handle);
+        REQUIRE(sum == 999 * 1000 / 2);
+
+        pool.run([](size_t, size_t) { REQUIRE(false); }, 0);
+    }
+}
+
+#ifdef HARDWARE_X86
 TEST_CASE("Asserts hardware support for CRC32/RTDSCP instruction") {
     REQUIRE(has_sse42());
     REQUIRE(has_rdtscp());
 }
+#endif
 
 TEST_CASE("Hash32 is more or less unifom") {
     uint32_t seed = 0xcafebabe;